@@ -0,0 +1,140 @@
+#ifndef ALIAS_SAMPLER_H
+#define ALIAS_SAMPLER_H
+
+#include <cstddef>
+#include <cstdint>
+#include <random>
+#include <utility>
+#include <vector>
+#include "element_not_found_exception.h"
+
+/**
+ * @brief Campionatore pesato su un insieme fisso di valori
+ *
+ * Costruisce in O(n) la tabella alias di Vose: ogni estrazione costa O(1) (un indice e
+ * un numero reale casuali) e restituisce un valore con probabilita' proporzionale al suo peso.
+ * Adatto a multiset che non cambiano piu' (vedi multiset::sampler); per multiset che
+ * cambiano si usano multiset::sample e multiset::sample_n.
+ *
+ * @tparam T tipo del dato
+ */
+template <typename T>
+class alias_sampler
+{
+    std::vector<T> _values;
+    std::vector<double> _prob;
+    std::vector<std::size_t> _alias;
+    std::uint64_t _total;
+
+public:
+    /**
+     * @brief Costruttore
+     * @param weights Coppie (valore, peso); i valori con peso 0 non vengono mai estratti
+     */
+    explicit alias_sampler(const std::vector<std::pair<T, std::uint64_t> > &weights) : _total(0)
+    {
+        std::size_t n = weights.size();
+        _values.reserve(n);
+        _prob.assign(n, 0);
+        _alias.assign(n, 0);
+        for (std::size_t i = 0; i < n; ++i)
+        {
+            _values.push_back(weights[i].first);
+            _total += weights[i].second;
+        }
+        if (_total == 0)
+        {
+            return;
+        }
+
+        // pesi scalati in modo che la media sia 1, divisi tra piccoli e grandi
+        std::vector<double> scaled(n);
+        std::vector<std::size_t> small;
+        std::vector<std::size_t> large;
+        for (std::size_t i = 0; i < n; ++i)
+        {
+            scaled[i] = static_cast<double>(weights[i].second) * n / static_cast<double>(_total);
+            if (scaled[i] < 1)
+            {
+                small.push_back(i);
+            }
+            else
+            {
+                large.push_back(i);
+            }
+        }
+        while (!small.empty() && !large.empty())
+        {
+            std::size_t s = small.back();
+            small.pop_back();
+            std::size_t l = large.back();
+            _prob[s] = scaled[s];
+            _alias[s] = l;
+            scaled[l] -= 1 - scaled[s];
+            if (scaled[l] < 1)
+            {
+                large.pop_back();
+                small.push_back(l);
+            }
+        }
+        // quelli rimasti valgono 1 a meno di errori di arrotondamento
+        for (std::size_t i = 0; i < large.size(); ++i)
+        {
+            _prob[large[i]] = 1;
+        }
+        for (std::size_t i = 0; i < small.size(); ++i)
+        {
+            _prob[small[i]] = 1;
+        }
+    }
+
+    /**
+     * @brief Size
+     * Ritorna il numero di valori distinti
+     */
+    std::size_t size() const { return _values.size(); }
+
+    /**
+     * @brief Total
+     * Ritorna la somma dei pesi
+     */
+    std::uint64_t total() const { return _total; }
+
+    /**
+     * @brief Sample
+     * Estrae un valore in O(1)
+     * @param rng Generatore di numeri casuali (UniformRandomBitGenerator)
+     * @throw element_not_found_exception se la somma dei pesi e' 0
+     */
+    template <typename Rng>
+    const T &sample(Rng &rng) const
+    {
+        if (_total == 0)
+        {
+            throw element_not_found_exception("Error, cannot sample from an empty multiset");
+        }
+        std::size_t i = std::uniform_int_distribution<std::size_t>(0, _values.size() - 1)(rng);
+        double u = std::uniform_real_distribution<double>(0, 1)(rng);
+        return _values[u < _prob[i] ? i : _alias[i]];
+    }
+
+    /**
+     * @brief Sample N
+     * Estrae n valori indipendenti (con ripetizione)
+     * @param rng Generatore di numeri casuali
+     * @param n Numero di estrazioni
+     */
+    template <typename Rng>
+    std::vector<T> sample_n(Rng &rng, std::size_t n) const
+    {
+        std::vector<T> result;
+        result.reserve(n);
+        for (std::size_t i = 0; i < n; ++i)
+        {
+            result.push_back(sample(rng));
+        }
+        return result;
+    }
+};
+
+#endif
@@ -0,0 +1,321 @@
+#ifndef APPROX_MULTISET_H
+#define APPROX_MULTISET_H
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <stdexcept>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+/**
+ * @brief Multiset approssimato a memoria fissa
+ *
+ * Le occorrenze sono stimate con un count-min sketch: depth righe di width contatori,
+ * con width = ceil(e / epsilon) e depth = ceil(ln(1 / delta)). La stima non e' mai minore
+ * del valore vero e, con probabilita' almeno 1 - delta, lo supera al piu' di epsilon * size().
+ * I valori piu' frequenti sono mantenuti in una tabella space-saving di capacita' fissa
+ * (min-heap sui conteggi con un indice per valore).
+ * La memoria occupata dipende solo dai parametri, non dal numero di valori inseriti.
+ * Due multiset costruiti con gli stessi parametri possono essere fusi con merge,
+ * ad esempio dopo averli riempiti su thread diversi.
+ *
+ * @tparam T tipo del dato
+ * @tparam Hash funtore di hash
+ * @tparam Eq funtore di equivalenza
+ */
+template <typename T, typename Hash, typename Eq>
+class approx_multiset
+{
+    /**
+     * @brief Elemento della tabella dei valori frequenti
+     * _count sovrastima le occorrenze del valore di al massimo _error
+     */
+    struct heavy_hitter
+    {
+        T _value;
+        std::uint64_t _count;
+        std::uint64_t _error;
+    };
+
+    std::size_t _width;
+    std::size_t _depth;
+    std::uint64_t _seed;
+    std::vector<std::uint64_t> _counters;
+    std::uint64_t _size;
+    std::size_t _capacity;
+    std::vector<heavy_hitter> _heap;
+    std::unordered_map<T, std::size_t, Hash, Eq> _index;
+    Hash _hash;
+
+    static std::uint64_t mix(std::uint64_t x)
+    {
+        x += 0x9e3779b97f4a7c15ULL;
+        x = (x ^ (x >> 30)) * 0xbf58476d1ce4e5b9ULL;
+        x = (x ^ (x >> 27)) * 0x94d049bb133111ebULL;
+        return x ^ (x >> 31);
+    }
+
+    // Coppia di hash da cui si ricavano gli indici di tutte le righe (h1 + i * h2)
+    std::pair<std::uint64_t, std::uint64_t> hashes(const T &value) const
+    {
+        std::uint64_t h1 = mix(static_cast<std::uint64_t>(_hash(value)) ^ _seed);
+        std::uint64_t h2 = mix(h1) | 1;
+        return std::make_pair(h1, h2);
+    }
+
+    std::uint64_t sketch_estimate(const T &value) const
+    {
+        std::pair<std::uint64_t, std::uint64_t> h = hashes(value);
+        std::uint64_t estimate = ~static_cast<std::uint64_t>(0);
+        for (std::size_t i = 0; i < _depth; ++i)
+        {
+            std::size_t col = static_cast<std::size_t>((h.first + i * h.second) % _width);
+            estimate = std::min(estimate, _counters[i * _width + col]);
+        }
+        return estimate;
+    }
+
+    void swap_entries(std::size_t a, std::size_t b)
+    {
+        std::swap(_heap[a], _heap[b]);
+        _index[_heap[a]._value] = a;
+        _index[_heap[b]._value] = b;
+    }
+
+    // Riporta in posizione l'elemento i dopo che il suo conteggio e' aumentato
+    void sift_down(std::size_t i)
+    {
+        for (;;)
+        {
+            std::size_t smallest = i;
+            std::size_t l = 2 * i + 1;
+            std::size_t r = l + 1;
+            if (l < _heap.size() && _heap[l]._count < _heap[smallest]._count)
+            {
+                smallest = l;
+            }
+            if (r < _heap.size() && _heap[r]._count < _heap[smallest]._count)
+            {
+                smallest = r;
+            }
+            if (smallest == i)
+            {
+                return;
+            }
+            swap_entries(i, smallest);
+            i = smallest;
+        }
+    }
+
+    void sift_up(std::size_t i)
+    {
+        while (i > 0 && _heap[i]._count < _heap[(i - 1) / 2]._count)
+        {
+            swap_entries(i, (i - 1) / 2);
+            i = (i - 1) / 2;
+        }
+    }
+
+    // Aggiorna la tabella space-saving con count nuove occorrenze di value
+    void track(const T &value, std::uint64_t count, std::uint64_t error)
+    {
+        if (_capacity == 0)
+        {
+            return;
+        }
+        typename std::unordered_map<T, std::size_t, Hash, Eq>::iterator it = _index.find(value);
+        if (it != _index.end())
+        {
+            _heap[it->second]._count += count;
+            _heap[it->second]._error += error;
+            sift_down(it->second);
+        }
+        else if (_heap.size() < _capacity)
+        {
+            heavy_hitter h = {value, count, error};
+            _heap.push_back(h);
+            _index[value] = _heap.size() - 1;
+            sift_up(_heap.size() - 1);
+        }
+        else
+        {
+            // il valore meno frequente lascia il posto al nuovo, che ne eredita il conteggio
+            std::uint64_t min = _heap[0]._count;
+            _index.erase(_heap[0]._value);
+            _heap[0]._value = value;
+            _heap[0]._count = min + count;
+            _heap[0]._error = min + error;
+            _index[value] = 0;
+            sift_down(0);
+        }
+    }
+
+public:
+    /**
+     * @brief Costruttore
+     * @param epsilon Errore massimo relativo a size() delle stime
+     * @param delta Probabilita' che una stima superi l'errore massimo
+     * @param heavy_hitters Numero di valori frequenti da tracciare
+     * @param seed Seme degli hash; multiset da fondere devono avere lo stesso seme
+     */
+    explicit approx_multiset(double epsilon = 0.001, double delta = 0.01, std::size_t heavy_hitters = 64,
+                             std::uint64_t seed = 0)
+        : _width(0), _depth(0), _seed(mix(seed)), _size(0), _capacity(heavy_hitters)
+    {
+        if (!(epsilon > 0 && epsilon < 1) || !(delta > 0 && delta < 1))
+        {
+            throw std::invalid_argument("Error, epsilon and delta must be in (0, 1)");
+        }
+        _width = static_cast<std::size_t>(std::ceil(std::exp(1.0) / epsilon));
+        _depth = static_cast<std::size_t>(std::ceil(std::log(1.0 / delta)));
+        _counters.assign(_width * _depth, 0);
+        _heap.reserve(_capacity);
+        _index.reserve(_capacity + 1);
+    }
+
+    /**
+     * @brief Size
+     * Ritorna il numero esatto di elementi aggiunti
+     */
+    std::uint64_t size() const { return _size; }
+
+    /**
+     * @brief Is Empty
+     * Controlla se il multiset e' vuoto
+     */
+    bool isEmpty() const { return _size == 0; }
+
+    /**
+     * @brief Width e Depth
+     * Dimensioni del count-min sketch
+     */
+    std::size_t width() const { return _width; }
+    std::size_t depth() const { return _depth; }
+
+    /**
+     * @brief Memory Usage
+     * Ritorna i byte occupati da sketch e tabella dei valori frequenti
+     */
+    std::size_t memory_usage() const
+    {
+        return _counters.capacity() * sizeof(std::uint64_t) + _heap.capacity() * sizeof(heavy_hitter) +
+               _index.bucket_count() * sizeof(void *) + _index.size() * (sizeof(T) + 2 * sizeof(void *));
+    }
+
+    /**
+     * @brief Add
+     * Aggiunge una o piu' occorrenze di un valore
+     * @param value
+     * @param count Numero di occorrenze da aggiungere
+     */
+    void add(const T &value, std::uint64_t count = 1)
+    {
+        std::pair<std::uint64_t, std::uint64_t> h = hashes(value);
+        for (std::size_t i = 0; i < _depth; ++i)
+        {
+            std::size_t col = static_cast<std::size_t>((h.first + i * h.second) % _width);
+            _counters[i * _width + col] += count;
+        }
+        _size += count;
+        track(value, count, 0);
+    }
+
+    /**
+     * @brief Get the Occurrences
+     * Ritorna una stima per eccesso delle occorrenze di un valore
+     * @param value
+     */
+    std::uint64_t getOccurrences(const T &value) const
+    {
+        std::uint64_t estimate = sketch_estimate(value);
+        typename std::unordered_map<T, std::size_t, Hash, Eq>::const_iterator it = _index.find(value);
+        if (it != _index.end())
+        {
+            estimate = std::min(estimate, _heap[it->second]._count);
+        }
+        return estimate;
+    }
+
+    /**
+     * @brief Contains
+     * Controlla se un valore puo' essere presente: un valore aggiunto e' sempre trovato,
+     * un valore mai aggiunto puo' risultare presente per collisione
+     * @param value
+     */
+    bool contains(const T &value) const
+    {
+        return sketch_estimate(value) > 0;
+    }
+
+    /**
+     * @brief Top K
+     * Ritorna fino a k valori frequenti con le loro occorrenze stimate, dal piu' frequente
+     * @param k Numero massimo di valori (al massimo la capacita' della tabella)
+     */
+    std::vector<std::pair<T, std::uint64_t> > top_k(std::size_t k) const
+    {
+        std::vector<std::pair<T, std::uint64_t> > result;
+        result.reserve(_heap.size());
+        for (std::size_t i = 0; i < _heap.size(); ++i)
+        {
+            result.push_back(std::make_pair(_heap[i]._value, getOccurrences(_heap[i]._value)));
+        }
+        std::sort(result.begin(), result.end(),
+                  [](const std::pair<T, std::uint64_t> &a, const std::pair<T, std::uint64_t> &b) {
+                      return a.second > b.second;
+                  });
+        if (result.size() > k)
+        {
+            result.resize(k);
+        }
+        return result;
+    }
+
+    /**
+     * @brief Merge
+     * Aggiunge a questo multiset il contenuto di un altro costruito con gli stessi parametri
+     * @param other Multiset da fondere (anche *this, che viene copiato prima)
+     * @throw std::invalid_argument se le dimensioni o il seme sono diversi
+     */
+    void merge(const approx_multiset &other)
+    {
+        if (&other == this)
+        {
+            // track modifica l'heap che si sta scorrendo
+            approx_multiset copy(other);
+            merge(copy);
+            return;
+        }
+        if (_width != other._width || _depth != other._depth || _seed != other._seed ||
+            _capacity != other._capacity)
+        {
+            throw std::invalid_argument("Error, cannot merge approx_multiset with different parameters");
+        }
+        for (std::size_t i = 0; i < _counters.size(); ++i)
+        {
+            _counters[i] += other._counters[i];
+        }
+        _size += other._size;
+        for (std::size_t i = 0; i < other._heap.size(); ++i)
+        {
+            track(other._heap[i]._value, other._heap[i]._count, other._heap[i]._error);
+        }
+    }
+
+    /**
+     * @brief Clear
+     * Azzera il multiset mantenendo i parametri
+     */
+    void clear()
+    {
+        std::fill(_counters.begin(), _counters.end(), 0);
+        _heap.clear();
+        _index.clear();
+        _size = 0;
+    }
+};
+
+#endif
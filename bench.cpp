@@ -0,0 +1,381 @@
+#include "multiset.h"
+#include "bitmap_multiset.h"
+#include "skiplist_multiset.h"
+#include "unrolled_multiset.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <functional>
+#include <iostream>
+#include <map>
+#include <random>
+#include <set>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+/**
+    @brief Benchmark di multiset e delle sue varianti confrontati con i container della libreria standard
+
+    bitmap_multiset accetta solo chiavi intere e viene misurato solo con int.
+    Per ogni combinazione di container, tipo della chiave, carico e dimensione misura
+    add, getOccurrences, contains, iterazione, copia, operator== e remove, e stampa
+    su standard output una riga CSV per misura:
+    container,key,workload,n,operation,ns_per_op
+
+    Uso: multiset_bench [dimensione_massima] [dimensione_massima_multiset]
+    Le dimensioni vanno da 100 alla massima per potenze di 10. multiset e' una lista
+    ordinata, quindi oltre la seconda soglia (default 10^4) viene saltato; skiplist_multiset
+    e unrolled_multiset (che salta un blocco di 32 valori per confronto) vengono misurati a
+    tutte le dimensioni.
+*/
+
+/**
+    @brief Funtore di ordinamento tra tipi interi
+
+    Ordina due interi in ordine decrescente.
+ */
+struct decr_int {
+    bool operator()(const int &a, const int &b) const {
+        return a < b;
+    }
+};
+
+/**
+    @brief Funtore di uguaglianza tra tipi interi
+ */
+struct equal_int {
+    bool operator()(const int &a, const int &b) const {
+        return a == b;
+    }
+};
+
+/**
+    @brief Struct che implementa un custom di un intero
+*/
+struct custom_int {
+    int value;
+    explicit custom_int(int value) : value(value) {}
+    custom_int(): value(0) {}
+    bool operator==(const custom_int &other) const {
+        return value == other.value;
+    }
+    bool operator!=(const custom_int &other) const {
+        return value != other.value;
+    }
+    bool operator<(const custom_int &other) const {
+        return value < other.value;
+    }
+};
+
+/**
+    @brief Funtore di uguaglianza tra custom int
+*/
+struct equal_custom_int {
+    bool operator()(const custom_int &a, const custom_int &b) const {
+        return a == b;
+    }
+};
+
+/**
+    @brief Funtore di ordinamento tra tipi custom int
+
+    Ordina due custom int in ordine decrescente.
+*/
+struct decr_custom_int {
+    bool operator()(const custom_int &a, const custom_int &b) const {
+        return a < b;
+    }
+};
+
+/**
+    @brief Funtore di hash per custom int
+*/
+struct hash_custom_int {
+    std::size_t operator()(const custom_int &a) const {
+        return std::hash<int>()(a.value);
+    }
+};
+
+// Accumula i risultati delle interrogazioni per evitare che vengano eliminate dal compilatore
+static volatile std::size_t sink = 0;
+
+/**
+    @brief Operazioni comuni ai container confrontati
+
+    Ogni specializzazione adatta un container all'interfaccia di multiset.
+*/
+template <typename Container>
+struct ops;
+
+/**
+    @brief Operazioni sui container con la stessa interfaccia di multiset
+*/
+template <typename Container, typename K>
+struct multiset_ops {
+    typedef Container container;
+    static void add(container &c, const K &k) { c.add(k); }
+    static void remove(container &c, const K &k) { c.remove(k); }
+    static std::size_t count(const container &c, const K &k) { return c.getOccurrences(k); }
+    static bool contains(const container &c, const K &k) { return c.contains(k); }
+    static std::size_t iterate(const container &c) {
+        std::size_t n = 0;
+        for (typename container::const_iterator it = c.begin(); it != c.end(); ++it) {
+            ++n;
+        }
+        return n;
+    }
+};
+
+template <typename K, typename C, typename E>
+struct ops<multiset<K, C, E> > : multiset_ops<multiset<K, C, E>, K> {
+    static const char *name() { return "multiset"; }
+};
+
+template <typename K, typename C, typename E>
+struct ops<skiplist_multiset<K, C, E> > : multiset_ops<skiplist_multiset<K, C, E>, K> {
+    static const char *name() { return "skiplist_multiset"; }
+};
+
+template <typename K, typename C, typename E>
+struct ops<unrolled_multiset<K, C, E> > : multiset_ops<unrolled_multiset<K, C, E>, K> {
+    static const char *name() { return "unrolled_multiset"; }
+};
+
+template <typename K>
+struct ops<bitmap_multiset<K> > : multiset_ops<bitmap_multiset<K>, K> {
+    static const char *name() { return "bitmap_multiset"; }
+};
+
+template <typename K, typename L>
+struct ops<std::multiset<K, L> > {
+    typedef std::multiset<K, L> container;
+    static const char *name() { return "std::multiset"; }
+    static void add(container &c, const K &k) { c.insert(k); }
+    static void remove(container &c, const K &k) { c.erase(c.find(k)); }
+    static std::size_t count(const container &c, const K &k) { return c.count(k); }
+    static bool contains(const container &c, const K &k) { return c.find(k) != c.end(); }
+    static std::size_t iterate(const container &c) {
+        std::size_t n = 0;
+        for (typename container::const_iterator it = c.begin(); it != c.end(); ++it) {
+            ++n;
+        }
+        return n;
+    }
+};
+
+/**
+    @brief Operazioni sui container associativi che contano le occorrenze di ogni chiave
+*/
+template <typename Container, typename K>
+struct counting_ops {
+    typedef Container container;
+    static void add(container &c, const K &k) { ++c[k]; }
+    static void remove(container &c, const K &k) {
+        typename container::iterator it = c.find(k);
+        if (--it->second == 0) {
+            c.erase(it);
+        }
+    }
+    static std::size_t count(const container &c, const K &k) {
+        typename container::const_iterator it = c.find(k);
+        return it == c.end() ? 0 : it->second;
+    }
+    static bool contains(const container &c, const K &k) { return c.find(k) != c.end(); }
+    static std::size_t iterate(const container &c) {
+        std::size_t n = 0;
+        for (typename container::const_iterator it = c.begin(); it != c.end(); ++it) {
+            n += it->second;
+        }
+        return n;
+    }
+};
+
+template <typename K, typename L>
+struct ops<std::map<K, std::size_t, L> > : counting_ops<std::map<K, std::size_t, L>, K> {
+    static const char *name() { return "std::map"; }
+};
+
+template <typename K, typename H, typename E>
+struct ops<std::unordered_map<K, std::size_t, H, E> > : counting_ops<std::unordered_map<K, std::size_t, H, E>, K> {
+    static const char *name() { return "std::unordered_map"; }
+};
+
+/**
+    @brief Genera la sequenza di chiavi di un carico
+
+    Le chiavi sono n/4 valori distinti. uniform li estrae uniformemente, zipf con legge di
+    Zipf (s = 1) su una permutazione casuale, sorted e reverse li producono in ordine
+    crescente e decrescente, ognuno ripetuto 4 volte di seguito.
+*/
+std::vector<int> make_workload(const std::string &workload, std::size_t n, std::mt19937_64 &rng) {
+    std::size_t distinct = std::max<std::size_t>(1, n / 4);
+    std::vector<int> keys(n);
+    if (workload == "uniform") {
+        std::uniform_int_distribution<std::size_t> dist(0, distinct - 1);
+        for (std::size_t i = 0; i < n; ++i) {
+            keys[i] = static_cast<int>(dist(rng));
+        }
+    } else if (workload == "zipf") {
+        std::vector<double> cdf(distinct);
+        double sum = 0;
+        for (std::size_t r = 0; r < distinct; ++r) {
+            sum += 1.0 / (r + 1);
+            cdf[r] = sum;
+        }
+        std::vector<int> perm(distinct);
+        for (std::size_t r = 0; r < distinct; ++r) {
+            perm[r] = static_cast<int>(r);
+        }
+        std::shuffle(perm.begin(), perm.end(), rng);
+        std::uniform_real_distribution<double> dist(0, sum);
+        for (std::size_t i = 0; i < n; ++i) {
+            std::size_t r = std::lower_bound(cdf.begin(), cdf.end(), dist(rng)) - cdf.begin();
+            keys[i] = perm[std::min(r, distinct - 1)];
+        }
+    } else if (workload == "sorted") {
+        for (std::size_t i = 0; i < n; ++i) {
+            keys[i] = static_cast<int>(i / 4);
+        }
+    } else {
+        for (std::size_t i = 0; i < n; ++i) {
+            keys[i] = static_cast<int>((n - 1 - i) / 4);
+        }
+    }
+    return keys;
+}
+
+template <typename F>
+double elapsed_ns(F f) {
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    f();
+    std::chrono::steady_clock::time_point stop = std::chrono::steady_clock::now();
+    return std::chrono::duration<double, std::nano>(stop - start).count();
+}
+
+/**
+    @brief Misura tutte le operazioni di un container su una sequenza di chiavi
+*/
+template <typename Container, typename K>
+void run(const char *key, const std::string &workload, const std::vector<K> &keys, std::ostream &out) {
+    typedef ops<Container> op;
+    std::size_t n = keys.size();
+    // con poche chiavi ripeto le misure per avere tempi significativi
+    std::size_t reps = std::max<std::size_t>(1, 100000 / n);
+    std::vector<K> probes(keys);
+    for (std::size_t i = 0; i < n; i += 2) {
+        probes[i] = K(-1 - static_cast<int>(i));
+    }
+
+    double add = 0;
+    Container c;
+    for (std::size_t r = 0; r < reps; ++r) {
+        Container tmp;
+        add += elapsed_ns([&]() {
+            for (std::size_t i = 0; i < n; ++i) {
+                op::add(tmp, keys[i]);
+            }
+        });
+        if (r + 1 == reps) {
+            c = tmp;
+        }
+    }
+    double count = elapsed_ns([&]() {
+        for (std::size_t r = 0; r < reps; ++r) {
+            for (std::size_t i = 0; i < n; ++i) {
+                sink = sink + op::count(c, keys[i]);
+            }
+        }
+    });
+    double contains = elapsed_ns([&]() {
+        for (std::size_t r = 0; r < reps; ++r) {
+            for (std::size_t i = 0; i < n; ++i) {
+                sink = sink + op::contains(c, probes[i]);
+            }
+        }
+    });
+    double iterate = elapsed_ns([&]() {
+        for (std::size_t r = 0; r < reps; ++r) {
+            sink = sink + op::iterate(c);
+        }
+    });
+    Container copy;
+    double copying = elapsed_ns([&]() {
+        for (std::size_t r = 0; r < reps; ++r) {
+            Container tmp(c);
+            if (r + 1 == reps) {
+                copy = tmp;
+            }
+        }
+    });
+    double equal = elapsed_ns([&]() {
+        for (std::size_t r = 0; r < reps; ++r) {
+            sink = sink + (c == copy);
+        }
+    });
+    double remove = 0;
+    for (std::size_t r = 0; r < reps; ++r) {
+        Container tmp(c);
+        remove += elapsed_ns([&]() {
+            for (std::size_t i = 0; i < n; ++i) {
+                op::remove(tmp, keys[i]);
+            }
+        });
+    }
+
+    double ops_count = static_cast<double>(reps) * n;
+    const char *names[] = {"add", "getOccurrences", "contains", "iterate", "copy", "operator==", "remove"};
+    double times[] = {add, count, contains, iterate, copying, equal, remove};
+    for (std::size_t i = 0; i < 7; ++i) {
+        out << op::name() << "," << key << "," << workload << "," << n << "," << names[i] << ","
+            << times[i] / ops_count << "\n";
+    }
+    out.flush();
+}
+
+// bitmap_multiset accetta solo chiavi intere: per gli altri tipi non misura nulla
+template <typename K>
+void run_bitmap(const char *, const std::string &, const std::vector<K> &, std::ostream &) {}
+
+void run_bitmap(const char *key, const std::string &workload, const std::vector<int> &keys, std::ostream &out) {
+    run<bitmap_multiset<int> >(key, workload, keys, out);
+}
+
+template <typename K, typename Comp, typename Eq, typename Less, typename Hash>
+void run_all(const char *key, const std::string &workload, const std::vector<int> &raw, std::size_t list_max,
+             std::ostream &out) {
+    std::vector<K> keys;
+    keys.reserve(raw.size());
+    for (std::size_t i = 0; i < raw.size(); ++i) {
+        keys.push_back(K(raw[i]));
+    }
+    if (keys.size() <= list_max) {
+        run<multiset<K, Comp, Eq> >(key, workload, keys, out);
+    }
+    run<skiplist_multiset<K, Comp, Eq> >(key, workload, keys, out);
+    run<unrolled_multiset<K, Comp, Eq> >(key, workload, keys, out);
+    run_bitmap(key, workload, keys, out);
+    run<std::multiset<K, Less> >(key, workload, keys, out);
+    run<std::map<K, std::size_t, Less> >(key, workload, keys, out);
+    run<std::unordered_map<K, std::size_t, Hash, Eq> >(key, workload, keys, out);
+}
+
+int main(int argc, char *argv[]) {
+    std::size_t max_size = argc > 1 ? std::strtoull(argv[1], nullptr, 10) : 100000;
+    std::size_t list_max = argc > 2 ? std::strtoull(argv[2], nullptr, 10) : 10000;
+    const char *workloads[] = {"uniform", "zipf", "sorted", "reverse"};
+
+    std::cout << "container,key,workload,n,operation,ns_per_op\n";
+    std::mt19937_64 rng(12345);
+    for (std::size_t n = 100; n <= max_size; n *= 10) {
+        for (std::size_t w = 0; w < 4; ++w) {
+            std::vector<int> raw = make_workload(workloads[w], n, rng);
+            run_all<int, decr_int, equal_int, std::less<int>, std::hash<int> >("int", workloads[w], raw, list_max,
+                                                                               std::cout);
+            run_all<custom_int, decr_custom_int, equal_custom_int, std::less<custom_int>, hash_custom_int>(
+                "custom_int", workloads[w], raw, list_max, std::cout);
+        }
+    }
+    return 0;
+}
@@ -0,0 +1,708 @@
+#ifndef BITMAP_MULTISET_H
+#define BITMAP_MULTISET_H
+
+#include <ostream>
+#include <algorithm>
+#include <iterator>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <type_traits>
+#include <utility>
+#include <vector>
+#include "element_not_found_exception.h"
+
+/**
+ * @brief Multiset di interi rappresentato con una bitmap compressa
+ *
+ * Pensato per domini interi densi (porte, identificativi piccoli). I valori sono divisi
+ * in contenitori da 2^16 valori, alla maniera delle roaring bitmap: un contenitore con al
+ * massimo 4096 valori e' un array ordinato dei 16 bit bassi, uno piu' denso una bitmap da
+ * 8 KiB. Le occorrenze sono in un array parallelo di un byte per valore, in ordine di valore;
+ * le occorrenze da 255 in su finiscono in una piccola tabella di overflow del contenitore.
+ * Per un insieme denso si spende poco piu' di un byte per valore distinto, contro i 16-24 byte
+ * (piu' l'overhead dell'allocatore) di un nodo della lista di multiset.
+ *
+ * Gli elementi sono visitati in ordine crescente di valore.
+ *
+ * @tparam T tipo intero del dato
+ */
+template <typename T>
+class bitmap_multiset
+{
+    static_assert(std::is_integral<T>::value && !std::is_same<T, bool>::value,
+                  "bitmap_multiset requires an integral T");
+
+    typedef typename std::make_unsigned<T>::type unsigned_type;
+
+    static const std::size_t array_limit = 4096;
+    static const std::size_t bitmap_words = 1024;
+    static const std::uint8_t count_overflow = 255;
+
+    /**
+     * @brief Contenitore dei valori che condividono i bit alti
+     */
+    struct container
+    {
+        std::uint64_t _key;
+        std::vector<std::uint16_t> _array;
+        std::vector<std::uint64_t> _bits;
+        std::vector<std::uint8_t> _counts;
+        std::vector<std::pair<std::uint16_t, std::uint64_t> > _overflow;
+        std::size_t _cardinality;
+
+        explicit container(std::uint64_t key) : _key(key), _cardinality(0) {}
+
+        bool is_bitmap() const { return !_bits.empty(); }
+
+        bool test(std::uint16_t low) const
+        {
+            if (is_bitmap())
+            {
+                return (_bits[low >> 6] >> (low & 63)) & 1;
+            }
+            return std::binary_search(_array.begin(), _array.end(), low);
+        }
+
+        // Numero di valori presenti minori di low
+        std::size_t rank(std::uint16_t low) const
+        {
+            if (is_bitmap())
+            {
+                std::size_t r = 0;
+                std::size_t word = low >> 6;
+                for (std::size_t i = 0; i < word; ++i)
+                {
+                    r += __builtin_popcountll(_bits[i]);
+                }
+                std::uint64_t mask = (static_cast<std::uint64_t>(1) << (low & 63)) - 1;
+                return r + __builtin_popcountll(_bits[word] & mask);
+            }
+            return std::lower_bound(_array.begin(), _array.end(), low) - _array.begin();
+        }
+
+        // Primo valore presente maggiore o uguale a from, 65536 se non esiste
+        std::uint32_t next(std::uint32_t from) const
+        {
+            if (is_bitmap())
+            {
+                std::size_t word = from >> 6;
+                if (word >= bitmap_words)
+                {
+                    return 65536;
+                }
+                std::uint64_t bits = _bits[word] & (~static_cast<std::uint64_t>(0) << (from & 63));
+                while (bits == 0)
+                {
+                    if (++word == bitmap_words)
+                    {
+                        return 65536;
+                    }
+                    bits = _bits[word];
+                }
+                return static_cast<std::uint32_t>(word * 64 + __builtin_ctzll(bits));
+            }
+            std::vector<std::uint16_t>::const_iterator it =
+                std::lower_bound(_array.begin(), _array.end(), from > 65535 ? 65535 : from);
+            if (it == _array.end() || *it < from)
+            {
+                return 65536;
+            }
+            return *it;
+        }
+
+        std::vector<std::pair<std::uint16_t, std::uint64_t> >::iterator find_overflow(std::uint16_t low)
+        {
+            return std::lower_bound(_overflow.begin(), _overflow.end(), std::make_pair(low, std::uint64_t(0)));
+        }
+
+        std::vector<std::pair<std::uint16_t, std::uint64_t> >::const_iterator find_overflow(std::uint16_t low) const
+        {
+            return std::lower_bound(_overflow.begin(), _overflow.end(), std::make_pair(low, std::uint64_t(0)));
+        }
+
+        std::uint64_t count(std::size_t r, std::uint16_t low) const
+        {
+            if (_counts[r] != count_overflow)
+            {
+                return _counts[r];
+            }
+            return find_overflow(low)->second;
+        }
+
+        void set_count(std::size_t r, std::uint16_t low, std::uint64_t c)
+        {
+            bool was_overflow = _counts[r] == count_overflow;
+            if (c < count_overflow)
+            {
+                if (was_overflow)
+                {
+                    _overflow.erase(find_overflow(low));
+                }
+                _counts[r] = static_cast<std::uint8_t>(c);
+            }
+            else if (was_overflow)
+            {
+                find_overflow(low)->second = c;
+            }
+            else
+            {
+                _overflow.insert(find_overflow(low), std::make_pair(low, c));
+                _counts[r] = count_overflow;
+            }
+        }
+
+        void to_bitmap()
+        {
+            _bits.assign(bitmap_words, 0);
+            for (std::size_t i = 0; i < _array.size(); ++i)
+            {
+                _bits[_array[i] >> 6] |= static_cast<std::uint64_t>(1) << (_array[i] & 63);
+            }
+            std::vector<std::uint16_t>().swap(_array);
+        }
+
+        void to_array()
+        {
+            _array.reserve(_cardinality);
+            for (std::uint32_t low = next(0); low < 65536; low = next(low + 1))
+            {
+                _array.push_back(static_cast<std::uint16_t>(low));
+            }
+            std::vector<std::uint64_t>().swap(_bits);
+        }
+
+        // Inserisce un valore nuovo in posizione r con c occorrenze
+        void insert(std::uint16_t low, std::size_t r, std::uint64_t c)
+        {
+            if (is_bitmap())
+            {
+                _bits[low >> 6] |= static_cast<std::uint64_t>(1) << (low & 63);
+            }
+            else
+            {
+                _array.insert(_array.begin() + r, low);
+            }
+            _counts.insert(_counts.begin() + r, 0);
+            set_count(r, low, c);
+            if (++_cardinality > array_limit && !is_bitmap())
+            {
+                to_bitmap();
+            }
+        }
+
+        // Accoda un valore maggiore di tutti quelli presenti
+        void append(std::uint16_t low, std::uint64_t c)
+        {
+            insert(low, _cardinality, c);
+        }
+
+        // Rimuove il valore in posizione r
+        void erase(std::uint16_t low, std::size_t r)
+        {
+            set_count(r, low, 0);
+            _counts.erase(_counts.begin() + r);
+            if (is_bitmap())
+            {
+                _bits[low >> 6] &= ~(static_cast<std::uint64_t>(1) << (low & 63));
+            }
+            else
+            {
+                _array.erase(_array.begin() + r);
+            }
+            // si torna all'array solo a meta' soglia, per non convertire a ogni operazione sul bordo
+            if (--_cardinality <= array_limit / 2 && is_bitmap())
+            {
+                to_array();
+            }
+        }
+
+        std::size_t memory_usage() const
+        {
+            return _array.capacity() * sizeof(std::uint16_t) + _bits.capacity() * sizeof(std::uint64_t) +
+                   _counts.capacity() + _overflow.capacity() * sizeof(_overflow[0]);
+        }
+    };
+
+    std::vector<container> _containers;
+    std::uint64_t _size;
+
+    // Converte il valore in un intero senza segno che ne conserva l'ordine
+    static std::uint64_t encode(const T &value)
+    {
+        unsigned_type u = static_cast<unsigned_type>(value);
+        if (std::is_signed<T>::value)
+        {
+            u ^= static_cast<unsigned_type>(static_cast<unsigned_type>(1) << (std::numeric_limits<unsigned_type>::digits - 1));
+        }
+        return u;
+    }
+
+    static T decode(std::uint64_t key, std::uint32_t low)
+    {
+        unsigned_type u = static_cast<unsigned_type>((key << 16) | low);
+        if (std::is_signed<T>::value)
+        {
+            u ^= static_cast<unsigned_type>(static_cast<unsigned_type>(1) << (std::numeric_limits<unsigned_type>::digits - 1));
+        }
+        return static_cast<T>(u);
+    }
+
+    typename std::vector<container>::iterator find_container(std::uint64_t key)
+    {
+        return std::lower_bound(_containers.begin(), _containers.end(), key,
+                                [](const container &c, std::uint64_t k) { return c._key < k; });
+    }
+
+    typename std::vector<container>::const_iterator find_container(std::uint64_t key) const
+    {
+        return std::lower_bound(_containers.begin(), _containers.end(), key,
+                                [](const container &c, std::uint64_t k) { return c._key < k; });
+    }
+
+    /**
+     * @brief Combina due multiset contenitore per contenitore
+     * @param other Secondo operando
+     * @param op Funzione che dalle occorrenze dei due operandi calcola quelle del risultato
+     * @param keep_left Copia i contenitori presenti solo a sinistra
+     * @param keep_right Copia i contenitori presenti solo a destra
+     */
+    template <typename Op>
+    bitmap_multiset combine(const bitmap_multiset &other, Op op, bool keep_left, bool keep_right) const
+    {
+        bitmap_multiset result;
+        std::size_t i = 0;
+        std::size_t j = 0;
+        while (i < _containers.size() || j < other._containers.size())
+        {
+            if (j == other._containers.size() ||
+                (i < _containers.size() && _containers[i]._key < other._containers[j]._key))
+            {
+                if (keep_left)
+                {
+                    result.push_container(_containers[i]);
+                }
+                ++i;
+            }
+            else if (i == _containers.size() || other._containers[j]._key < _containers[i]._key)
+            {
+                if (keep_right)
+                {
+                    result.push_container(other._containers[j]);
+                }
+                ++j;
+            }
+            else
+            {
+                const container &a = _containers[i];
+                const container &b = other._containers[j];
+                container c(a._key);
+                std::uint32_t la = a.next(0);
+                std::uint32_t lb = b.next(0);
+                std::size_t ra = 0;
+                std::size_t rb = 0;
+                while (la < 65536 || lb < 65536)
+                {
+                    std::uint32_t low = std::min(la, lb);
+                    std::uint64_t ca = la == low ? a.count(ra, static_cast<std::uint16_t>(low)) : 0;
+                    std::uint64_t cb = lb == low ? b.count(rb, static_cast<std::uint16_t>(low)) : 0;
+                    std::uint64_t count = op(ca, cb);
+                    if (count > 0)
+                    {
+                        c.append(static_cast<std::uint16_t>(low), count);
+                    }
+                    if (la == low)
+                    {
+                        la = a.next(low + 1);
+                        ++ra;
+                    }
+                    if (lb == low)
+                    {
+                        lb = b.next(low + 1);
+                        ++rb;
+                    }
+                }
+                if (c._cardinality > 0)
+                {
+                    result.push_container(c);
+                }
+                ++i;
+                ++j;
+            }
+        }
+        return result;
+    }
+
+    void push_container(const container &c)
+    {
+        _containers.push_back(c);
+        for (std::size_t r = 0; r < c._counts.size(); ++r)
+        {
+            _size += c._counts[r];
+        }
+        for (std::size_t k = 0; k < c._overflow.size(); ++k)
+        {
+            _size += c._overflow[k].second - count_overflow;
+        }
+    }
+
+public:
+    /**
+     * @brief Costruttore di default
+     * Inizializza un nuovo multiset vuoto
+     */
+    bitmap_multiset() : _size(0) {}
+
+    /**
+     * @brief Costruttore tramite iteratore
+     * @param b Iteratore all'inizio del range
+     * @param e Iteratore alla fine del range
+     */
+    template <typename Iter>
+    bitmap_multiset(Iter b, Iter e) : _size(0)
+    {
+        for (; b != e; ++b)
+        {
+            add(static_cast<T>(*b));
+        }
+    }
+
+    /**
+     * @brief Operatore di uguaglianza
+     * Due multiset sono uguali se contengono gli stessi valori con le stesse occorrenze
+     */
+    bool operator==(const bitmap_multiset &other) const
+    {
+        if (_size != other._size || _containers.size() != other._containers.size())
+        {
+            return false;
+        }
+        for (std::size_t i = 0; i < _containers.size(); ++i)
+        {
+            const container &a = _containers[i];
+            const container &b = other._containers[i];
+            if (a._key != b._key || a._cardinality != b._cardinality || a._counts != b._counts ||
+                a._overflow != b._overflow)
+            {
+                return false;
+            }
+            if (a.is_bitmap() ? a._bits != b._bits : a._array != b._array)
+            {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    bool operator!=(const bitmap_multiset &other) const
+    {
+        return !(*this == other);
+    }
+
+    /**
+     * @brief Size
+     * Ritorna il numero totale di elementi (occorrenze comprese)
+     */
+    std::uint64_t size() const { return _size; }
+
+    /**
+     * @brief Distinct
+     * Ritorna il numero di valori distinti
+     */
+    std::size_t distinct() const
+    {
+        std::size_t n = 0;
+        for (std::size_t i = 0; i < _containers.size(); ++i)
+        {
+            n += _containers[i]._cardinality;
+        }
+        return n;
+    }
+
+    /**
+     * @brief Is Empty
+     * Controlla se il multiset e' vuoto
+     */
+    bool isEmpty() const { return _size == 0; }
+
+    /**
+     * @brief Memory Usage
+     * Ritorna i byte allocati per contenitori, bitmap e occorrenze
+     */
+    std::size_t memory_usage() const
+    {
+        std::size_t bytes = _containers.capacity() * sizeof(container);
+        for (std::size_t i = 0; i < _containers.size(); ++i)
+        {
+            bytes += _containers[i].memory_usage();
+        }
+        return bytes;
+    }
+
+    /**
+     * @brief Get the Occurrences
+     * Ritorna il numero di occorrenze di un valore nel multiset
+     * @param value
+     */
+    std::uint64_t getOccurrences(const T &value) const
+    {
+        std::uint64_t u = encode(value);
+        typename std::vector<container>::const_iterator c = find_container(u >> 16);
+        std::uint16_t low = static_cast<std::uint16_t>(u);
+        if (c == _containers.end() || c->_key != (u >> 16) || !c->test(low))
+        {
+            return 0;
+        }
+        return c->count(c->rank(low), low);
+    }
+
+    /**
+     * @brief Contains
+     * Controlla se un valore e' presente nel multiset
+     * @param value
+     */
+    bool contains(const T &value) const
+    {
+        std::uint64_t u = encode(value);
+        typename std::vector<container>::const_iterator c = find_container(u >> 16);
+        return c != _containers.end() && c->_key == (u >> 16) && c->test(static_cast<std::uint16_t>(u));
+    }
+
+    /**
+     * @brief Add
+     * Aggiunge un valore al multiset
+     * @param value
+     */
+    void add(const T &value)
+    {
+        std::uint64_t u = encode(value);
+        typename std::vector<container>::iterator c = find_container(u >> 16);
+        if (c == _containers.end() || c->_key != (u >> 16))
+        {
+            c = _containers.insert(c, container(u >> 16));
+        }
+        std::uint16_t low = static_cast<std::uint16_t>(u);
+        std::size_t r = c->rank(low);
+        if (c->test(low))
+        {
+            c->set_count(r, low, c->count(r, low) + 1);
+        }
+        else
+        {
+            c->insert(low, r, 1);
+        }
+        ++_size;
+    }
+
+    /**
+     * @brief Remove
+     * Rimuove una occorrenza di un valore dal multiset
+     * @param value
+     * @throw element_not_found_exception se il valore non e' presente
+     */
+    void remove(const T &value)
+    {
+        std::uint64_t u = encode(value);
+        typename std::vector<container>::iterator c = find_container(u >> 16);
+        std::uint16_t low = static_cast<std::uint16_t>(u);
+        if (c == _containers.end() || c->_key != (u >> 16) || !c->test(low))
+        {
+            throw element_not_found_exception("Error, element not found in multiset");
+        }
+        std::size_t r = c->rank(low);
+        std::uint64_t count = c->count(r, low);
+        if (count > 1)
+        {
+            c->set_count(r, low, count - 1);
+        }
+        else
+        {
+            c->erase(low, r);
+            if (c->_cardinality == 0)
+            {
+                _containers.erase(c);
+            }
+        }
+        --_size;
+    }
+
+    /**
+     * @brief Clear
+     * Svuota il multiset
+     */
+    void clear()
+    {
+        _containers.clear();
+        _size = 0;
+    }
+
+    /**
+     * @brief Unite
+     * Ritorna l'unione: ogni valore con il massimo delle occorrenze nei due multiset
+     */
+    bitmap_multiset unite(const bitmap_multiset &other) const
+    {
+        return combine(other, [](std::uint64_t a, std::uint64_t b) { return std::max(a, b); }, true, true);
+    }
+
+    /**
+     * @brief Intersect
+     * Ritorna l'intersezione: ogni valore con il minimo delle occorrenze nei due multiset
+     */
+    bitmap_multiset intersect(const bitmap_multiset &other) const
+    {
+        return combine(other, [](std::uint64_t a, std::uint64_t b) { return std::min(a, b); }, false, false);
+    }
+
+    /**
+     * @brief Subtract
+     * Ritorna la differenza: le occorrenze di other vengono tolte da quelle di questo multiset
+     */
+    bitmap_multiset subtract(const bitmap_multiset &other) const
+    {
+        return combine(other, [](std::uint64_t a, std::uint64_t b) { return a > b ? a - b : 0; }, true, false);
+    }
+
+    /**
+     * @brief Const Iterator
+     * Iteratore costante in ordine crescente, con la stessa semantica di multiset::const_iterator
+     */
+    class const_iterator
+    {
+    public:
+        typedef std::forward_iterator_tag iterator_category;
+        typedef T value_type;
+        typedef ptrdiff_t difference_type;
+        typedef const T *pointer;
+        typedef const T &reference;
+
+        const_iterator() : _owner(nullptr), _container(0), _low(0), _rank(0), _counter(1), _value() {}
+
+        const_iterator &operator++()
+        {
+            if (_counter == occurrences())
+            {
+                const container &c = _owner->_containers[_container];
+                _counter = 1;
+                ++_rank;
+                _low = c.next(_low + 1);
+                if (_low == 65536)
+                {
+                    ++_container;
+                    _rank = 0;
+                    settle();
+                }
+                else
+                {
+                    _value = decode(c._key, _low);
+                }
+            }
+            else
+            {
+                _counter++;
+            }
+            return *this;
+        }
+
+        const_iterator operator++(int)
+        {
+            const_iterator tmp(*this);
+            ++*this;
+            return tmp;
+        }
+
+        bool operator==(const const_iterator &other) const
+        {
+            return _container == other._container && _low == other._low;
+        }
+
+        bool operator!=(const const_iterator &other) const
+        {
+            return !(*this == other);
+        }
+
+        reference operator*() const
+        {
+            return _value;
+        }
+
+        pointer operator->() const
+        {
+            return &_value;
+        }
+
+        // Ritorna il numero di occorrenze dell'elemento puntato
+        std::uint64_t occurrences() const
+        {
+            return _owner->_containers[_container].count(_rank, static_cast<std::uint16_t>(_low));
+        }
+
+    private:
+        friend class bitmap_multiset;
+
+        const_iterator(const bitmap_multiset *owner, std::size_t container)
+            : _owner(owner), _container(container), _low(0), _rank(0), _counter(1), _value()
+        {
+            settle();
+        }
+
+        // Si posiziona sul primo valore del contenitore corrente, o sulla fine
+        void settle()
+        {
+            if (_container < _owner->_containers.size())
+            {
+                const container &c = _owner->_containers[_container];
+                _low = c.next(0);
+                _value = decode(c._key, _low);
+            }
+            else
+            {
+                _container = _owner->_containers.size();
+                _low = 0;
+            }
+        }
+
+        const bitmap_multiset *_owner;
+        std::size_t _container;
+        std::uint32_t _low;
+        std::size_t _rank;
+        std::uint64_t _counter;
+        T _value;
+    };
+
+    const_iterator begin() const
+    {
+        return const_iterator(this, 0);
+    }
+
+    const_iterator end() const
+    {
+        return const_iterator(this, _containers.size());
+    }
+
+    /**
+     * @brief Operatore <<
+     * Stampa il multiset nello stesso formato di multiset, in ordine crescente
+     */
+    friend std::ostream &operator<<(std::ostream &os, const bitmap_multiset &m)
+    {
+        os << "{";
+        for (std::size_t i = 0; i < m._containers.size(); ++i)
+        {
+            const container &c = m._containers[i];
+            std::size_t r = 0;
+            for (std::uint32_t low = c.next(0); low < 65536; low = c.next(low + 1), ++r)
+            {
+                if (i > 0 || r > 0)
+                {
+                    os << ", ";
+                }
+                os << "<" << decode(c._key, low) << ", " << c.count(r, static_cast<std::uint16_t>(low)) << ">";
+            }
+        }
+        os << "}\n";
+        return os;
+    }
+};
+
+#endif
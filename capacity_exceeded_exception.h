@@ -0,0 +1,23 @@
+#ifndef CAPACITY_EXCEEDED_EXCEPTION_H
+#define CAPACITY_EXCEEDED_EXCEPTION_H
+
+#include <stdexcept>
+#include <string>
+/**
+ * @brief Classe eccezione custom che deriva da std::runtime_error
+ * Viene lanciata quando un multiset a capacita' fissa non ha posto per un nuovo valore
+ */
+class capacity_exceeded_exception : public std::runtime_error
+{
+public:
+    /**
+     * @brief Construttore che riceve un messaggio d'errore
+     *
+     * @param msg
+     */
+    capacity_exceeded_exception(const std::string &msg) : std::runtime_error(msg)
+    {
+    }
+};
+
+#endif
@@ -0,0 +1,404 @@
+#include "multiset.h"
+#include "skiplist_multiset.h"
+#include "unrolled_multiset.h"
+
+#include <cassert>
+#include <cstddef>
+#include <cstdlib>
+#include <iostream>
+#include <new>
+
+/**
+    @brief Test di regressione su allocazioni e complessita' di multiset
+
+    Un operator new globale conta le allocazioni; un tipo intero strumentato conta
+    le chiamate ai funtori e agli operatori di confronto. I controlli falliscono se:
+    - add di un valore gia' presente alloca memoria;
+    - copia e operator== allocano piu' del necessario o crescono piu' che linearmente;
+    - add, remove, getOccurrences e contains superano il numero di confronti
+      previsto per una lista ordinata (due per nodo attraversato, piu' uno e,
+      per add, il controllo del finger);
+    - l'inserimento di valori gia' ordinati secondo Comp non e' lineare;
+    - splice, extract e insert di un nodo allocano memoria;
+    - erase per iteratore ed erase_if confrontano valori o allocano memoria;
+    - diff e apply non sono lineari;
+    - le ricerche in skiplist_multiset non sono logaritmiche;
+    - unrolled_multiset alloca piu' di un blocco ogni B/2 valori distinti.
+*/
+
+static std::size_t allocations = 0;
+
+void *operator new(std::size_t size) {
+    ++allocations;
+    void *p = std::malloc(size == 0 ? 1 : size);
+    if (p == nullptr) {
+        throw std::bad_alloc();
+    }
+    return p;
+}
+
+void operator delete(void *p) noexcept {
+    std::free(p);
+}
+
+void operator delete(void *p, std::size_t) noexcept {
+    std::free(p);
+}
+
+// Confronti eseguiti sul tipo strumentato dall'ultimo azzeramento
+static std::size_t comparisons = 0;
+
+/**
+    @brief Intero che conta i confronti
+*/
+struct counted_int {
+    int value;
+    explicit counted_int(int value) : value(value) {}
+    counted_int(): value(0) {}
+    bool operator!=(const counted_int &other) const {
+        ++comparisons;
+        return value != other.value;
+    }
+};
+
+/**
+    @brief Funtore di uguaglianza tra counted_int
+*/
+struct equal_counted_int {
+    bool operator()(const counted_int &a, const counted_int &b) const {
+        ++comparisons;
+        return a.value == b.value;
+    }
+};
+
+/**
+    @brief Funtore di ordinamento tra counted_int
+
+    Ordina due counted_int in ordine decrescente.
+*/
+struct decr_counted_int {
+    bool operator()(const counted_int &a, const counted_int &b) const {
+        ++comparisons;
+        return a.value < b.value;
+    }
+};
+
+/**
+    @brief Funtore di ordinamento tra counted_int
+
+    Ordina due counted_int in ordine crescente.
+*/
+struct cresc_counted_int {
+    bool operator()(const counted_int &a, const counted_int &b) const {
+        ++comparisons;
+        return a.value > b.value;
+    }
+};
+
+typedef multiset<counted_int, decr_counted_int, equal_counted_int> counted_multiset;
+
+// Costruisce un multiset con n valori distinti, ognuno con 3 occorrenze
+counted_multiset make_multiset(int n) {
+    counted_multiset m;
+    for (int k = 0; k < 3; ++k) {
+        for (int i = 0; i < n; ++i) {
+            m.add(counted_int(i));
+        }
+    }
+    return m;
+}
+
+/**
+    @brief Controlla che il costo raddoppi al massimo (con margine) quando n raddoppia
+*/
+void check_linear(const char *what, std::size_t small, std::size_t large) {
+    std::cout << "  " << what << ": " << small << " -> " << large << std::endl;
+    assert(large <= 2 * small + small / 2 + 16);
+}
+
+/**
+    @brief add di un valore gia' presente non alloca
+*/
+void check_duplicate_add() {
+    counted_multiset m = make_multiset(500);
+    std::size_t before = allocations;
+    for (int i = 0; i < 500; ++i) {
+        m.add(counted_int(i));
+    }
+    assert(allocations == before);
+
+    multiset<counted_int, decr_counted_int, equal_counted_int, unsigned int, 8> small;
+    before = allocations;
+    for (int i = 0; i < 8; ++i) {
+        small.add(counted_int(i));
+        small.add(counted_int(i));
+    }
+    assert(allocations == before);
+}
+
+/**
+    @brief la copia alloca un nodo per valore distinto e cresce linearmente
+*/
+void check_copy() {
+    std::size_t cost[2];
+    for (int k = 0; k < 2; ++k) {
+        int n = 1000 << k;
+        counted_multiset m = make_multiset(n);
+        std::size_t before = allocations;
+        comparisons = 0;
+        counted_multiset copy(m);
+        assert(allocations - before == static_cast<std::size_t>(n));
+        cost[k] = comparisons;
+
+        before = allocations;
+        counted_multiset assigned;
+        assigned = m;
+        assert(allocations - before == static_cast<std::size_t>(n));
+    }
+    check_linear("copy comparisons", cost[0], cost[1]);
+}
+
+/**
+    @brief operator== tra multiset dello stesso tipo non alloca e cresce linearmente
+*/
+void check_equality() {
+    std::size_t cost[2];
+    for (int k = 0; k < 2; ++k) {
+        int n = 1000 << k;
+        counted_multiset a = make_multiset(n);
+        counted_multiset b(a);
+        std::size_t before = allocations;
+        comparisons = 0;
+        assert(a == b);
+        assert(allocations == before);
+        cost[k] = comparisons;
+    }
+    check_linear("operator== comparisons", cost[0], cost[1]);
+
+    // con un ordinamento diverso il confronto resta corretto
+    multiset<counted_int, cresc_counted_int, equal_counted_int> reversed;
+    counted_multiset a = make_multiset(10);
+    for (int k = 0; k < 3; ++k) {
+        for (int i = 9; i >= 0; --i) {
+            reversed.add(counted_int(i));
+        }
+    }
+    assert(a == reversed);
+}
+
+/**
+    @brief ogni operazione fa al massimo due confronti per nodo attraversato, piu' uno
+    (add uno in piu' per controllare il finger)
+*/
+void check_operation_bounds() {
+    const int n = 200;
+    counted_multiset m = make_multiset(n);
+    // la lista e' decrescente: il valore i e' preceduto da n - 1 - i nodi
+    for (int i = 0; i < n; ++i) {
+        std::size_t bound = 2 * static_cast<std::size_t>(n - i) + 1;
+
+        comparisons = 0;
+        m.getOccurrences(counted_int(i));
+        assert(comparisons <= bound);
+
+        comparisons = 0;
+        m.contains(counted_int(i));
+        assert(comparisons <= bound);
+
+        comparisons = 0;
+        m.add(counted_int(i));
+        assert(comparisons <= bound + 1);
+
+        comparisons = 0;
+        m.remove(counted_int(i));
+        assert(comparisons <= bound);
+    }
+
+    // un valore nuovo in testa costa il controllo del finger e due confronti
+    comparisons = 0;
+    m.add(counted_int(n));
+    assert(comparisons <= 3);
+}
+
+/**
+    @brief valori che arrivano nell'ordine di Comp si inseriscono in tempo lineare
+*/
+void check_sorted_stream() {
+    std::size_t cost[2];
+    for (int k = 0; k < 2; ++k) {
+        int n = 1000 << k;
+        counted_multiset m;
+        comparisons = 0;
+        // l'ordine e' decrescente, con ogni valore ripetuto
+        for (int i = n - 1; i >= 0; --i) {
+            m.add(counted_int(i));
+            m.add(counted_int(i));
+        }
+        cost[k] = comparisons;
+        assert(m.size() == static_cast<unsigned int>(2 * n));
+    }
+    check_linear("sorted add comparisons", cost[0], cost[1]);
+
+    // con il suggerimento anche un flusso che riparte dall'inizio resta lineare
+    for (int k = 0; k < 2; ++k) {
+        int n = 1000 << k;
+        counted_multiset m = make_multiset(n);
+        comparisons = 0;
+        counted_multiset::const_iterator hint = m.begin();
+        for (int i = n - 1; i >= 0; --i) {
+            hint = m.add(hint, counted_int(i));
+        }
+        cost[k] = comparisons;
+    }
+    check_linear("hinted add comparisons", cost[0], cost[1]);
+}
+
+/**
+    @brief merge e subtract sono lineari nella somma delle dimensioni
+*/
+void check_merge_subtract() {
+    std::size_t cost[2];
+    for (int k = 0; k < 2; ++k) {
+        int n = 1000 << k;
+        counted_multiset a = make_multiset(n);
+        counted_multiset b = make_multiset(n);
+        comparisons = 0;
+        a.merge(b);
+        a.subtract(b);
+        cost[k] = comparisons;
+        assert(a == b);
+    }
+    check_linear("merge/subtract comparisons", cost[0], cost[1]);
+}
+
+/**
+    @brief splice e il passaggio di nodi con extract/insert non allocano
+*/
+void check_splice() {
+    std::size_t cost[2];
+    for (int k = 0; k < 2; ++k) {
+        int n = 1000 << k;
+        counted_multiset a = make_multiset(n);
+        counted_multiset b;
+        for (int i = 0; i < 2 * n; ++i) {
+            b.add(counted_int(i));
+        }
+        std::size_t before = allocations;
+        comparisons = 0;
+        a.splice(b);
+        cost[k] = comparisons;
+        assert(allocations == before);
+        assert(b.isEmpty());
+        assert(a.size() == static_cast<unsigned int>(5 * n));
+
+        b.insert(a.extract(counted_int(0)));
+        b.insert(a.extract(counted_int(2 * n - 1)));
+        assert(allocations == before);
+        assert(b.getOccurrences(counted_int(0)) == 4);
+    }
+    check_linear("splice comparisons", cost[0], cost[1]);
+}
+
+/**
+    @brief erase per iteratore ed erase_if non fanno confronti ne' allocazioni
+*/
+void check_erase() {
+    counted_multiset m = make_multiset(2000);
+    std::size_t before = allocations;
+    comparisons = 0;
+    counted_multiset::const_iterator it = m.begin();
+    while (it != m.end()) {
+        it = it->value % 2 == 0 ? m.erase(it) : ++it;
+    }
+    assert(m.size() == 3000);
+    assert(m.erase_if([](const counted_int &v) { return v.value % 3 == 0; }) == 999);
+    assert(comparisons == 0);
+    assert(allocations == before);
+}
+
+/**
+    @brief diff e apply scorrono le liste una volta sola
+*/
+void check_diff() {
+    std::size_t cost[2];
+    for (int k = 0; k < 2; ++k) {
+        int n = 1000 << k;
+        counted_multiset a = make_multiset(n);
+        counted_multiset b = make_multiset(2 * n);
+        b.erase_if([](const counted_int &v) { return v.value % 3 == 0; });
+        comparisons = 0;
+        counted_multiset::delta_type d = diff(a, b);
+        a.apply(d);
+        cost[k] = comparisons;
+        assert(a == b);
+    }
+    check_linear("diff/apply comparisons", cost[0], cost[1]);
+}
+
+/**
+    @brief le ricerche in skiplist_multiset crescono in modo logaritmico
+*/
+void check_skiplist() {
+    std::size_t cost[2];
+    for (int k = 0; k < 2; ++k) {
+        int n = 1000 << (4 * k);
+        skiplist_multiset<counted_int, decr_counted_int, equal_counted_int> s;
+        // inserimento in ordine sparso: i * 7919 mod n e' una permutazione di 0..n-1
+        for (int i = 0; i < n; ++i) {
+            s.add(counted_int(static_cast<int>((static_cast<long long>(i) * 7919) % n)));
+        }
+        comparisons = 0;
+        for (int i = 0; i < n; ++i) {
+            assert(s.contains(counted_int(i)));
+        }
+        cost[k] = comparisons / n;
+    }
+    // con n 16 volte piu' grande una lista costerebbe 16 volte tanto, la skip list pochi confronti in piu'
+    std::cout << "  skiplist comparisons per lookup: " << cost[0] << " -> " << cost[1] << std::endl;
+    assert(cost[1] <= 2 * cost[0]);
+}
+
+/**
+    @brief unrolled_multiset alloca un blocco ogni B/2 valori distinti al massimo
+*/
+void check_unrolled() {
+    const int n = 4096;
+    std::size_t before = allocations;
+    unrolled_multiset<counted_int, decr_counted_int, equal_counted_int> u;
+    for (int k = 0; k < 2; ++k) {
+        for (int i = 0; i < n; ++i) {
+            u.add(counted_int(static_cast<int>((static_cast<long long>(i) * 7919) % n)));
+        }
+    }
+    std::size_t blocks = allocations - before;
+    std::cout << "  unrolled blocks for " << n << " values: " << blocks << std::endl;
+    assert(blocks == u.blocks());
+    assert(blocks <= 2 * n / 32 + 1);
+}
+
+
+int main() {
+    std::cout << "check_duplicate_add..." << std::endl;
+    check_duplicate_add();
+    std::cout << "check_copy..." << std::endl;
+    check_copy();
+    std::cout << "check_equality..." << std::endl;
+    check_equality();
+    std::cout << "check_operation_bounds..." << std::endl;
+    check_operation_bounds();
+    std::cout << "check_sorted_stream..." << std::endl;
+    check_sorted_stream();
+    std::cout << "check_merge_subtract..." << std::endl;
+    check_merge_subtract();
+    std::cout << "check_splice..." << std::endl;
+    check_splice();
+    std::cout << "check_erase..." << std::endl;
+    check_erase();
+    std::cout << "check_diff..." << std::endl;
+    check_diff();
+    std::cout << "check_skiplist..." << std::endl;
+    check_skiplist();
+    std::cout << "check_unrolled..." << std::endl;
+    check_unrolled();
+    return 0;
+}
@@ -0,0 +1,23 @@
+#ifndef COUNT_OVERFLOW_EXCEPTION_H
+#define COUNT_OVERFLOW_EXCEPTION_H
+
+#include <stdexcept>
+#include <string>
+/**
+ * @brief Classe eccezione custom che deriva da std::runtime_error
+ * Viene lanciata quando un contatore con controllo dell'overflow supererebbe il suo massimo
+ */
+class count_overflow_exception : public std::runtime_error
+{
+public:
+    /**
+     * @brief Construttore che riceve un messaggio d'errore
+     *
+     * @param msg
+     */
+    count_overflow_exception(const std::string &msg) : std::runtime_error(msg)
+    {
+    }
+};
+
+#endif
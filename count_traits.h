@@ -0,0 +1,76 @@
+#ifndef COUNT_TRAITS_H
+#define COUNT_TRAITS_H
+
+#include <limits>
+#include <type_traits>
+#include "count_overflow_exception.h"
+
+/**
+ * @brief Contatore che si ferma al valore massimo invece di ricominciare da zero
+ * Da usare come CountT di multiset, ad esempio saturating_count<std::uint8_t>
+ *
+ * @tparam U tipo intero senza segno del contatore
+ */
+template <typename U>
+struct saturating_count
+{
+};
+
+/**
+ * @brief Contatore che lancia count_overflow_exception invece di superare il valore massimo
+ * Da usare come CountT di multiset, ad esempio checked_count<std::uint16_t>
+ *
+ * @tparam U tipo intero senza segno del contatore
+ */
+template <typename U>
+struct checked_count
+{
+};
+
+/**
+ * @brief Politica di incremento dei contatori di multiset
+ * Un tipo intero senza segno usato direttamente come CountT non ha controlli
+ * (come gli unsigned int usati finora). room(c, d) ritorna quanto di d si puo'
+ * aggiungere a c.
+ *
+ * @tparam C tipo del contatore o politica
+ */
+template <typename C>
+struct count_traits
+{
+    static_assert(std::is_unsigned<C>::value, "multiset counts must be unsigned integers");
+    typedef C type;
+
+    static constexpr type room(type, type d) { return d; }
+};
+
+template <typename U>
+struct count_traits<saturating_count<U> >
+{
+    static_assert(std::is_unsigned<U>::value, "multiset counts must be unsigned integers");
+    typedef U type;
+
+    static constexpr type room(type c, type d)
+    {
+        type left = std::numeric_limits<type>::max() - c;
+        return d < left ? d : left;
+    }
+};
+
+template <typename U>
+struct count_traits<checked_count<U> >
+{
+    static_assert(std::is_unsigned<U>::value, "multiset counts must be unsigned integers");
+    typedef U type;
+
+    static constexpr type room(type c, type d)
+    {
+        if (d > std::numeric_limits<type>::max() - c)
+        {
+            throw count_overflow_exception("Error, multiset count overflow");
+        }
+        return d;
+    }
+};
+
+#endif
@@ -0,0 +1,379 @@
+#ifndef EXTERNAL_MULTISET_BUILDER_H
+#define EXTERNAL_MULTISET_BUILDER_H
+
+#include <cerrno>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <fstream>
+#include <memory>
+#include <queue>
+#include <string>
+#include <system_error>
+#include <type_traits>
+#include <utility>
+#include <vector>
+#include <unistd.h>
+#include "multiset.h"
+#include "multiset_io.h"
+
+/**
+ * @brief Costruttore di multiset piu' grandi della memoria disponibile
+ *
+ * I valori vengono accumulati in un multiset in memoria; quando il numero di valori distinti
+ * supera il budget di memoria il multiset viene scritto su un file temporaneo (run) in formato
+ * compatto e svuotato. finish() fonde le run con un merge a k vie e scrive il multiset finale
+ * su file, leggibile con multiset::deserialize o, nel layout piatto, con mapped_multiset.
+ *
+ * @tparam T tipo del dato (intero o trivially copyable)
+ * @tparam Comp funtore di comparazione
+ * @tparam Eq funtore di equivalenza
+ */
+template <typename T, typename Comp, typename Eq>
+class external_multiset_builder
+{
+    typedef typename std::is_integral<T>::type integral_key;
+
+    /**
+     * @brief Lettore sequenziale di una run
+     * Mantiene il record corrente (valore e occorrenze) della run
+     */
+    struct run_reader
+    {
+        std::vector<char> _buffer;
+        std::ifstream _in;
+        multiset_io::byte_reader _reader;
+        std::uint64_t _remaining;
+        std::uint64_t _prev;
+        T _value;
+        std::uint64_t _occurrences;
+
+        run_reader(const std::string &path, std::size_t buffer_size)
+            : _buffer(buffer_size), _in(), _reader(_in), _remaining(0), _prev(0), _value(), _occurrences(0)
+        {
+            _in.rdbuf()->pubsetbuf(_buffer.data(), static_cast<std::streamsize>(_buffer.size()));
+            _in.open(path.c_str(), std::ios::binary);
+            if (!_in)
+            {
+                throw std::system_error(errno, std::generic_category(), "Error, cannot open run " + path);
+            }
+            multiset_io::header h = multiset_io::read_header(_reader);
+            _remaining = h.distinct;
+        }
+
+        // Passa al record successivo, ritorna false se la run e' finita
+        bool next()
+        {
+            if (_remaining == 0)
+            {
+                return false;
+            }
+            --_remaining;
+            _value = multiset_io::read_key<T>(_reader, _prev, integral_key());
+            _occurrences = _reader.get_varint();
+            return true;
+        }
+    };
+
+    /**
+     * @brief Ordina le run nella coda di priorita' in modo che in cima ci sia
+     * il valore che viene prima nell'ordine del multiset
+     */
+    struct reader_order
+    {
+        Comp _cmp;
+        bool operator()(const run_reader *a, const run_reader *b) const
+        {
+            return _cmp(a->_value, b->_value);
+        }
+    };
+
+    typedef multiset<T, Comp, Eq> run_type;
+
+    run_type _run;
+    std::size_t _run_distinct;
+    std::size_t _max_distinct;
+    std::size_t _io_buffer_size;
+    std::string _temp_dir;
+    std::vector<std::string> _runs;
+    std::uint64_t _size;
+    Eq _eq;
+
+    // Stima dei byte occupati da un nodo del multiset in memoria, overhead dell'allocatore compreso
+    static const std::size_t node_bytes = sizeof(T) + sizeof(typename run_type::count_type) + sizeof(void *) + 16;
+
+    std::string make_temp_path() const
+    {
+        std::string pattern = _temp_dir + "/multiset_run_XXXXXX";
+        std::vector<char> name(pattern.begin(), pattern.end());
+        name.push_back('\0');
+        int fd = ::mkstemp(name.data());
+        if (fd < 0)
+        {
+            throw std::system_error(errno, std::generic_category(), "Error, cannot create a run in " + _temp_dir);
+        }
+        ::close(fd);
+        return std::string(name.data());
+    }
+
+    // Apre uno stream di output con un buffer della dimensione configurata
+    void open_output(std::ofstream &out, std::vector<char> &buffer, const std::string &path) const
+    {
+        buffer.resize(_io_buffer_size);
+        out.rdbuf()->pubsetbuf(buffer.data(), static_cast<std::streamsize>(buffer.size()));
+        out.open(path.c_str(), std::ios::binary | std::ios::trunc);
+        if (!out)
+        {
+            throw std::system_error(errno, std::generic_category(), "Error, cannot open " + path);
+        }
+    }
+
+    // Scrive il multiset in memoria in una nuova run e lo svuota
+    void spill()
+    {
+        std::string path = make_temp_path();
+        _runs.push_back(path);
+        std::vector<char> buffer;
+        std::ofstream out;
+        open_output(out, buffer, path);
+        _run.serialize(out, multiset_io::layout_compact);
+        out.close();
+        if (!out)
+        {
+            throw std::system_error(errno, std::generic_category(), "Error, cannot write run " + path);
+        }
+        _run.clear();
+        _run_distinct = 0;
+    }
+
+    void remove_runs()
+    {
+        for (std::size_t i = 0; i < _runs.size(); ++i)
+        {
+            std::remove(_runs[i].c_str());
+        }
+        _runs.clear();
+    }
+
+public:
+    /**
+     * @brief Costruttore
+     * @param memory_budget Byte massimi da usare per il multiset in memoria
+     * @param io_buffer_size Dimensione in byte del buffer di ogni file letto o scritto
+     * @param temp_dir Directory in cui scrivere le run temporanee
+     */
+    explicit external_multiset_builder(std::size_t memory_budget = 64 << 20,
+                                       std::size_t io_buffer_size = 1 << 20,
+                                       const std::string &temp_dir = "/tmp")
+        : _run_distinct(0), _max_distinct(memory_budget / node_bytes), _io_buffer_size(io_buffer_size),
+          _temp_dir(temp_dir), _size(0)
+    {
+        if (_max_distinct == 0)
+        {
+            _max_distinct = 1;
+        }
+        if (_io_buffer_size == 0)
+        {
+            _io_buffer_size = 1;
+        }
+    }
+
+    external_multiset_builder(const external_multiset_builder &other) = delete;
+    external_multiset_builder &operator=(const external_multiset_builder &other) = delete;
+
+    /**
+     * @brief Distruttore
+     * Cancella le run temporanee non ancora fuse
+     */
+    ~external_multiset_builder()
+    {
+        remove_runs();
+    }
+
+    /**
+     * @brief Add
+     * Aggiunge un valore, scrivendo una run su disco se il budget di memoria e' esaurito
+     * @param value
+     */
+    void add(const T &value)
+    {
+        // una sola ricerca: il valore e' nuovo se dopo l'aggiunta ha una occorrenza
+        if (_run.add(_run.end(), value).occurrences() == 1)
+        {
+            if (_run_distinct == _max_distinct)
+            {
+                // il nuovo nodo non entra nel budget: la run viene scritta senza di lui
+                typename run_type::node_handle n = _run.extract(value);
+                spill();
+                _run.insert(std::move(n));
+            }
+            ++_run_distinct;
+        }
+        ++_size;
+    }
+
+    /**
+     * @brief Add
+     * Aggiunge tutti i valori di un range
+     * @param b Iteratore all'inizio del range
+     * @param e Iteratore alla fine del range
+     */
+    template <typename Iter>
+    void add(Iter b, Iter e)
+    {
+        for (; b != e; ++b)
+        {
+            add(static_cast<T>(*b));
+        }
+    }
+
+    /**
+     * @brief Size
+     * Ritorna il numero totale di valori aggiunti
+     */
+    std::uint64_t size() const { return _size; }
+
+    /**
+     * @brief Runs
+     * Ritorna il numero di run scritte su disco finora
+     */
+    std::size_t runs() const { return _runs.size(); }
+
+    /**
+     * @brief Finish
+     * Fonde le run e il multiset in memoria e scrive il risultato su file.
+     * Dopo la chiamata il builder e' vuoto e puo' essere riutilizzato.
+     * @param path File di destinazione
+     * @param l Layout del file (il layout piatto puo' essere aperto con mapped_multiset)
+     */
+    void finish(const std::string &path, multiset_io::layout l = multiset_io::layout_flat)
+    {
+        if (_runs.empty())
+        {
+            std::vector<char> buffer;
+            std::ofstream out;
+            open_output(out, buffer, path);
+            _run.serialize(out, l);
+            out.close();
+            if (!out)
+            {
+                throw std::system_error(errno, std::generic_category(), "Error, cannot write " + path);
+            }
+            _run.clear();
+            _run_distinct = 0;
+            _size = 0;
+            return;
+        }
+        if (!_run.isEmpty())
+        {
+            spill();
+        }
+
+        std::vector<std::unique_ptr<run_reader> > readers;
+        std::priority_queue<run_reader *, std::vector<run_reader *>, reader_order> queue;
+        for (std::size_t i = 0; i < _runs.size(); ++i)
+        {
+            readers.push_back(std::unique_ptr<run_reader>(new run_reader(_runs[i], _io_buffer_size)));
+            if (readers.back()->next())
+            {
+                queue.push(readers.back().get());
+            }
+        }
+
+        std::vector<char> buffer;
+        std::ofstream out;
+        open_output(out, buffer, path);
+        multiset_io::header h;
+        h.version = multiset_io::version;
+        h.layout = l;
+        h.encoding = l == multiset_io::layout_flat ? multiset_io::key_raw : multiset_io::encoding_for<T>();
+        h.key_size = sizeof(T);
+        h.distinct = 0;
+        h.total = 0;
+
+        // nel layout piatto le occorrenze vanno dopo tutte le chiavi: le accumulo in un file a parte
+        std::string counts_path;
+        std::vector<char> counts_buffer;
+        std::ofstream counts_out;
+        if (l == multiset_io::layout_flat)
+        {
+            counts_path = make_temp_path();
+            _runs.push_back(counts_path);
+            open_output(counts_out, counts_buffer, counts_path);
+        }
+
+        {
+            multiset_io::byte_writer w(out);
+            multiset_io::byte_writer counts_w(l == multiset_io::layout_flat ? counts_out : out);
+            multiset_io::write_header(w, h);
+            std::uint64_t prev = 0;
+            while (!queue.empty())
+            {
+                run_reader *top = queue.top();
+                queue.pop();
+                T value = top->_value;
+                std::uint64_t occurrences = top->_occurrences;
+                if (top->next())
+                {
+                    queue.push(top);
+                }
+                while (!queue.empty() && _eq(queue.top()->_value, value))
+                {
+                    top = queue.top();
+                    queue.pop();
+                    occurrences += top->_occurrences;
+                    if (top->next())
+                    {
+                        queue.push(top);
+                    }
+                }
+
+                if (l == multiset_io::layout_flat)
+                {
+                    w.write(&value, sizeof(T));
+                    counts_w.write(&occurrences, sizeof(occurrences));
+                }
+                else
+                {
+                    multiset_io::write_key(w, value, prev, integral_key());
+                    w.put_varint(occurrences);
+                }
+                ++h.distinct;
+                h.total += occurrences;
+            }
+        }
+        readers.clear();
+
+        if (l == multiset_io::layout_flat)
+        {
+            counts_out.close();
+            std::vector<char> in_buffer(_io_buffer_size);
+            std::ifstream counts_in;
+            counts_in.rdbuf()->pubsetbuf(in_buffer.data(), static_cast<std::streamsize>(in_buffer.size()));
+            counts_in.open(counts_path.c_str(), std::ios::binary);
+            multiset_io::byte_writer w(out);
+            w.pad(multiset_io::flat_counts_offset(h.distinct, sizeof(T)) -
+                  multiset_io::header_size - h.distinct * sizeof(T));
+            if (h.distinct > 0)
+            {
+                out << counts_in.rdbuf();
+            }
+        }
+
+        // riscrivo l'header con i totali ora noti
+        out.seekp(0);
+        {
+            multiset_io::byte_writer w(out);
+            multiset_io::write_header(w, h);
+        }
+        out.close();
+        if (!out)
+        {
+            throw std::system_error(errno, std::generic_category(), "Error, cannot write " + path);
+        }
+        remove_runs();
+        _size = 0;
+    }
+};
+
+#endif
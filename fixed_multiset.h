@@ -0,0 +1,361 @@
+#ifndef FIXED_MULTISET_H
+#define FIXED_MULTISET_H
+
+#include <ostream>
+#include <iterator>
+#include <cstddef>
+#include <initializer_list>
+#include "element_not_found_exception.h"
+#include "capacity_exceeded_exception.h"
+#include "count_traits.h"
+
+/**
+ * @brief Multiset a capacita' fissa utilizzabile in espressioni costanti
+ *
+ * I valori distinti sono tenuti ordinati secondo Comp in un array di Cap elementi interno
+ * all'oggetto, con le occorrenze in un array parallelo: nessuna allocazione e ricerche
+ * binarie in O(log n). Tutti i metodi tranne operator<< sono constexpr, quindi con un tipo
+ * T letterale e funtori con operator() constexpr il multiset puo' essere costruito durante
+ * la compilazione e interrogato a runtime senza costi di inizializzazione:
+ *
+ *   constexpr fixed_multiset<int, Comp, Eq, 16> codes = [] {
+ *       fixed_multiset<int, Comp, Eq, 16> m;
+ *       m.add(200, 10);
+ *       m.add(404, 3);
+ *       return m;
+ *   }();
+ *   static_assert(codes.getOccurrences(404) == 3, "");
+ *
+ * Superare la capacita' o il massimo di CountT in una espressione costante e' un errore di compilazione.
+ *
+ * @tparam T tipo del dato (default constructible)
+ * @tparam Comp funtore di comparazione
+ * @tparam Eq funtore di equivalenza
+ * @tparam Cap numero massimo di valori distinti
+ * @tparam CountT tipo delle occorrenze (vedi multiset)
+ */
+template <typename T, typename Comp, typename Eq, std::size_t Cap, typename CountT = unsigned int>
+class fixed_multiset
+{
+public:
+    typedef typename count_traits<CountT>::type count_type;
+
+private:
+    static_assert(Cap > 0, "fixed_multiset needs a capacity of at least one value");
+
+    T _values[Cap] = {};
+    count_type _counts[Cap] = {};
+    std::size_t _distinct = 0;
+    count_type _size = 0;
+    Comp _cmp = {};
+    Eq _eq = {};
+
+    /**
+     * @brief Posizione di value: il primo indice il cui valore non precede value
+     */
+    constexpr std::size_t lower_bound(const T &value) const
+    {
+        std::size_t lo = 0;
+        std::size_t hi = _distinct;
+        while (lo < hi)
+        {
+            std::size_t mid = lo + (hi - lo) / 2;
+            if (_cmp(value, _values[mid]))
+            {
+                lo = mid + 1;
+            }
+            else
+            {
+                hi = mid;
+            }
+        }
+        return lo;
+    }
+
+    // Indice di value, _distinct se non e' presente
+    constexpr std::size_t find(const T &value) const
+    {
+        std::size_t i = lower_bound(value);
+        return i < _distinct && _eq(_values[i], value) ? i : _distinct;
+    }
+
+public:
+    /**
+     * @brief Costruttore di default
+     */
+    constexpr fixed_multiset() {}
+
+    /**
+     * @brief Costruttore da una lista di valori
+     * Aggiunge ogni valore della lista, ripetizioni comprese
+     * @param values Valori da aggiungere
+     * @throw capacity_exceeded_exception se i valori distinti sono piu' di Cap
+     */
+    constexpr fixed_multiset(std::initializer_list<T> values)
+    {
+        for (const T &value : values)
+        {
+            add(value);
+        }
+    }
+
+    /**
+     * @brief Size
+     * Ritorna il numero totale di elementi (occorrenze comprese)
+     */
+    constexpr count_type size() const { return _size; }
+
+    /**
+     * @brief Distinct
+     * Ritorna il numero di valori distinti
+     */
+    constexpr std::size_t distinct() const { return _distinct; }
+
+    /**
+     * @brief Capacity
+     * Ritorna il numero massimo di valori distinti
+     */
+    constexpr std::size_t capacity() const { return Cap; }
+
+    /**
+     * @brief Is Empty
+     * Controlla se il multiset e' vuoto
+     */
+    constexpr bool isEmpty() const { return _size == 0; }
+
+    /**
+     * @brief Add
+     * Aggiunge occurrences occorrenze di un valore; un valore nuovo sposta i valori successivi
+     * @param value
+     * @param occurrences Occorrenze da aggiungere
+     * @throw capacity_exceeded_exception se il valore e' nuovo e il multiset ha gia' Cap valori distinti
+     */
+    constexpr void add(const T &value, count_type occurrences = 1)
+    {
+        if (occurrences == 0)
+        {
+            return;
+        }
+        std::size_t i = lower_bound(value);
+        if (i < _distinct && _eq(_values[i], value))
+        {
+            count_type d = count_traits<CountT>::room(_counts[i], occurrences);
+            d = count_traits<CountT>::room(_size, d);
+            _counts[i] += d;
+            _size += d;
+            return;
+        }
+        count_type d = count_traits<CountT>::room(_size, occurrences);
+        if (d == 0)
+        {
+            return;
+        }
+        if (_distinct == Cap)
+        {
+            throw capacity_exceeded_exception("Error, fixed multiset capacity exceeded");
+        }
+        for (std::size_t j = _distinct; j > i; --j)
+        {
+            _values[j] = _values[j - 1];
+            _counts[j] = _counts[j - 1];
+        }
+        _values[i] = value;
+        _counts[i] = d;
+        ++_distinct;
+        _size += d;
+    }
+
+    /**
+     * @brief Remove
+     * Rimuove una occorrenza di un valore
+     * @param value
+     * @throw element_not_found_exception se il valore non e' presente
+     */
+    constexpr void remove(const T &value)
+    {
+        std::size_t i = find(value);
+        if (i == _distinct)
+        {
+            throw element_not_found_exception("Error, element not found in multiset");
+        }
+        --_size;
+        if (--_counts[i] > 0)
+        {
+            return;
+        }
+        for (std::size_t j = i; j + 1 < _distinct; ++j)
+        {
+            _values[j] = _values[j + 1];
+            _counts[j] = _counts[j + 1];
+        }
+        --_distinct;
+        _values[_distinct] = T();
+    }
+
+    /**
+     * @brief Get the Occurrences
+     * Ritorna il numero di occorrenze di un valore, con una ricerca binaria
+     * @param value
+     */
+    constexpr count_type getOccurrences(const T &value) const
+    {
+        std::size_t i = find(value);
+        return i == _distinct ? 0 : _counts[i];
+    }
+
+    /**
+     * @brief Contains
+     * Controlla se un valore e' presente nel multiset, con una ricerca binaria
+     * @param value
+     */
+    constexpr bool contains(const T &value) const
+    {
+        return find(value) != _distinct;
+    }
+
+    /**
+     * @brief Clear
+     * Svuota il multiset
+     */
+    constexpr void clear()
+    {
+        for (std::size_t i = 0; i < _distinct; ++i)
+        {
+            _values[i] = T();
+            _counts[i] = 0;
+        }
+        _distinct = 0;
+        _size = 0;
+    }
+
+    /**
+     * @brief Operatore di uguaglianza
+     * Confronta i valori nell'ordine di Comp e le loro occorrenze in O(n)
+     * @param other Multiset da confrontare
+     */
+    constexpr bool operator==(const fixed_multiset &other) const
+    {
+        if (_size != other._size || _distinct != other._distinct)
+        {
+            return false;
+        }
+        for (std::size_t i = 0; i < _distinct; ++i)
+        {
+            if (!_eq(_values[i], other._values[i]) || _counts[i] != other._counts[i])
+            {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    /**
+     * @brief Operatore di disuguaglianza
+     * @param other Multiset da confrontare
+     */
+    constexpr bool operator!=(const fixed_multiset &other) const
+    {
+        return !(*this == other);
+    }
+
+    /**
+     * @brief Const Iterator
+     * Iteratore costante sugli elementi nell'ordine di Comp, con la stessa semantica di multiset::const_iterator
+     */
+    class const_iterator
+    {
+    public:
+        typedef std::forward_iterator_tag iterator_category;
+        typedef T value_type;
+        typedef ptrdiff_t difference_type;
+        typedef const T *pointer;
+        typedef const T &reference;
+
+        constexpr const_iterator() : _set(nullptr), _index(0), _counter(1) {}
+
+        constexpr const_iterator &operator++()
+        {
+            if (_counter == _set->_counts[_index])
+            {
+                ++_index;
+                _counter = 1;
+            }
+            else
+            {
+                _counter++;
+            }
+            return *this;
+        }
+
+        constexpr const_iterator operator++(int)
+        {
+            const_iterator tmp(*this);
+            ++*this;
+            return tmp;
+        }
+
+        constexpr bool operator==(const const_iterator &other) const
+        {
+            return _set == other._set && _index == other._index;
+        }
+
+        constexpr bool operator!=(const const_iterator &other) const
+        {
+            return !(*this == other);
+        }
+
+        constexpr reference operator*() const
+        {
+            return _set->_values[_index];
+        }
+
+        constexpr pointer operator->() const
+        {
+            return &(_set->_values[_index]);
+        }
+
+        // Ritorna il numero di occorrenze dell'elemento puntato
+        constexpr count_type occurrences() const
+        {
+            return _set->_counts[_index];
+        }
+
+    private:
+        friend class fixed_multiset;
+        constexpr const_iterator(const fixed_multiset *set, std::size_t index) : _set(set), _index(index), _counter(1) {}
+        const fixed_multiset *_set;
+        std::size_t _index;
+        count_type _counter;
+    };
+
+    constexpr const_iterator begin() const
+    {
+        return const_iterator(this, 0);
+    }
+
+    constexpr const_iterator end() const
+    {
+        return const_iterator(this, _distinct);
+    }
+
+    /**
+     * @brief Operatore <<
+     * Stampa il multiset nello stesso formato di multiset
+     */
+    friend std::ostream &operator<<(std::ostream &os, const fixed_multiset &m)
+    {
+        os << "{";
+        for (std::size_t i = 0; i < m._distinct; ++i)
+        {
+            if (i > 0)
+            {
+                os << ", ";
+            }
+            os << "<" << m._values[i] << ", " << m._counts[i] << ">";
+        }
+        os << "}" << '\n';
+        return os;
+    }
+};
+
+#endif
@@ -0,0 +1,23 @@
+#ifndef INVALID_FORMAT_EXCEPTION_H
+#define INVALID_FORMAT_EXCEPTION_H
+
+#include <stdexcept>
+#include <string>
+/**
+ * @brief Classe eccezione custom che deriva da std::runtime_error
+ * Viene lanciata quando un multiset serializzato non rispetta il formato atteso
+ */
+class invalid_format_exception : public std::runtime_error
+{
+public:
+    /**
+     * @brief Construttore che riceve un messaggio d'errore
+     *
+     * @param msg
+     */
+    invalid_format_exception(const std::string &msg) : std::runtime_error(msg)
+    {
+    }
+};
+
+#endif
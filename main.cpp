@@ -1,7 +1,21 @@
 #include "multiset.h"
+#include "mapped_multiset.h"
+#include "external_multiset_builder.h"
+#include "bitmap_multiset.h"
+#include "approx_multiset.h"
+#include "windowed_multiset.h"
+#include "ranked_multiset.h"
+#include "skiplist_multiset.h"
+#include "unrolled_multiset.h"
+#include "fixed_multiset.h"
 
 #include <iostream>
+#include <sstream>
+#include <fstream>
+#include <cstdio>
 #include <cassert>
+#include <random>
+#include <functional>
 
 /**
     @brief Funtore di ordinamento tra tipi interi
@@ -20,7 +34,7 @@ struct decr_int {
     Determina se due interi sono uguali.
 */
 struct equal_int {
-    bool operator()(const int &a, const int &b) const {
+    constexpr bool operator()(const int &a, const int &b) const {
         return a == b;
     }
 };
@@ -53,7 +67,7 @@ struct decr_char {
     Ordina due caratteri in ordine ascendente.
 */
 struct cresc_int {
-    bool operator()(const int &a, const int &b) const {
+    constexpr bool operator()(const int &a, const int &b) const {
         return a > b;
     }
 };
@@ -125,6 +139,26 @@ struct cresc_custom_int {
     }
 };
 
+/**
+    @brief Funtore di uguaglianza tra stringhe
+*/
+struct equal_string {
+    bool operator()(const std::string &a, const std::string &b) const {
+        return a == b;
+    }
+};
+
+/**
+    @brief Funtore di ordinamento tra stringhe
+
+    Ordina due stringhe in ordine alfabetico.
+*/
+struct cresc_string {
+    bool operator()(const std::string &a, const std::string &b) const {
+        return a > b;
+    }
+};
+
 /** 
     @brief test d'uso costruttori con tipi primitivi
 */
@@ -896,6 +930,1912 @@ void test_isEmpty_custom() {
     assert(m.isEmpty());
 }
 
+/** 
+    @brief test di serializzazione e deserializzazione binaria con tipi primitivi
+*/
+void test_serialize() {
+    multiset<int, decr_int, equal_int> m;
+    m.add(8);
+    m.add(-1);
+    m.add(2);
+    m.add(2);
+    m.add(300000);
+    m.add(3);
+    m.add(2);
+    m.add(-70000);
+    std::stringstream ss;
+    m.serialize(ss);
+
+    multiset<int, decr_int, equal_int> m2;
+    m2.add(42);
+    m2.deserialize(ss);
+    assert(m == m2);
+    assert(m2.size() == 8);
+    assert(m2.getOccurrences(2) == 3);
+    assert(m2.getOccurrences(42) == 0);
+
+    multiset<int, decr_int, equal_int> empty;
+    std::stringstream ss2;
+    empty.serialize(ss2);
+    m2.deserialize(ss2);
+    assert(m2.isEmpty());
+
+    multiset<char, decr_char, equal_char> m3;
+    m3.add('z');
+    m3.add('a');
+    m3.add('a');
+    std::stringstream ss3;
+    m3.serialize(ss3);
+    multiset<char, decr_char, equal_char> m4;
+    m4.deserialize(ss3);
+    assert(m3 == m4);
+}
+
+/** 
+    @brief test di deserializzazione di dati non validi
+*/
+void test_deserialize_invalid() {
+    multiset<int, decr_int, equal_int> m;
+    m.add(1);
+    m.add(5);
+    std::stringstream ss;
+    m.serialize(ss);
+    std::string data = ss.str();
+
+    // ordine diverso da quello di Comp
+    multiset<int, cresc_int, equal_int> m2;
+    m2.add(7);
+    std::stringstream ss2(data);
+    bool thrown = false;
+    try {
+        m2.deserialize(ss2);
+    } catch (invalid_format_exception &) {
+        thrown = true;
+    }
+    assert(thrown);
+    assert(m2.size() == 1);
+    assert(m2.contains(7));
+
+    // dati troncati
+    std::stringstream ss3(data.substr(0, data.size() - 1));
+    thrown = false;
+    try {
+        m2.deserialize(ss3);
+    } catch (invalid_format_exception &) {
+        thrown = true;
+    }
+    assert(thrown);
+
+    // tipo della chiave diverso
+    multiset<char, decr_char, equal_char> m3;
+    std::stringstream ss4(data);
+    thrown = false;
+    try {
+        m3.deserialize(ss4);
+    } catch (invalid_format_exception &) {
+        thrown = true;
+    }
+    assert(thrown);
+}
+
+/** 
+    @brief test d'uso della vista mappata in memoria con tipi primitivi
+*/
+void test_mapped_multiset() {
+    multiset<int, decr_int, equal_int> m;
+    m.add(8);
+    m.add(1);
+    m.add(2);
+    m.add(2);
+    m.add(3);
+    m.add(3);
+    m.add(2);
+    m.add(9);
+    const char *path = "test_mapped_multiset.bin";
+    {
+        std::ofstream out(path, std::ios::binary);
+        m.serialize(out, multiset_io::layout_flat);
+    }
+
+    // il layout piatto si rilegge anche con deserialize
+    std::ifstream in(path, std::ios::binary);
+    multiset<int, decr_int, equal_int> m2;
+    m2.deserialize(in);
+    assert(m == m2);
+
+    {
+        mapped_multiset<int, decr_int, equal_int> mm(path);
+        assert(mm.size() == 8);
+        assert(mm.distinct() == 5);
+        assert(mm.getOccurrences(2) == 3);
+        assert(mm.getOccurrences(9) == 1);
+        assert(mm.getOccurrences(4) == 0);
+        assert(mm.contains(8));
+        assert(!mm.contains(10));
+        assert(mm.countRange(8, 2) == 6);
+        assert(mm.countRange(7, 4) == 0);
+
+        mapped_multiset<int, decr_int, equal_int>::const_iterator it = mm.begin();
+        multiset<int, decr_int, equal_int>::const_iterator it2 = m.begin();
+        while (it2 != m.end()) {
+            assert(*it == *it2);
+            ++it;
+            ++it2;
+        }
+        assert(it == mm.end());
+
+        it = mm.lower_bound(5);
+        assert(*it == 3);
+        assert(it.occurrences() == 2);
+        it = mm.upper_bound(3);
+        assert(*it == 2);
+    }
+
+    bool thrown = false;
+    try {
+        mapped_multiset<char, decr_char, equal_char> wrong(path);
+    } catch (invalid_format_exception &) {
+        thrown = true;
+    }
+    assert(thrown);
+    std::remove(path);
+}
+
+/** 
+    @brief test del formato testuale bufferizzato e del relativo parser
+*/
+void test_format_parse() {
+    multiset<int, decr_int, equal_int> m;
+    m.add(8);
+    m.add(-1);
+    m.add(2);
+    m.add(2);
+    m.add(3);
+    std::ostringstream os;
+    m.format(os);
+    assert(os.str() == "{<8, 1>, <3, 1>, <2, 2>, <-1, 1>}");
+    std::ostringstream os2;
+    os2 << m;
+    assert(os2.str() == os.str() + "\n");
+
+    std::istringstream is(os.str() + " trailing");
+    multiset<int, decr_int, equal_int> m2;
+    m2.add(5);
+    m2.parse(is);
+    assert(m == m2);
+    std::string rest;
+    is >> rest;
+    assert(rest == "trailing");
+
+    // valori fuori ordine e ripetuti
+    std::istringstream is2("{ <1, 2>,<7,1> , <1, 1>, <4, 3> }");
+    m2.parse(is2);
+    assert(m2.size() == 7);
+    assert(m2.getOccurrences(1) == 3);
+    assert(m2.getOccurrences(4) == 3);
+    std::ostringstream os3;
+    m2.format(os3);
+    assert(os3.str() == "{<7, 1>, <4, 3>, <1, 3>}");
+
+    std::istringstream is3("{}");
+    m2.parse(is3);
+    assert(m2.isEmpty());
+
+    multiset<char, decr_char, equal_char> m3;
+    m3.add(',');
+    m3.add(' ');
+    m3.add('a');
+    std::ostringstream os4;
+    m3.format(os4);
+    assert(os4.str() == "{<a, 1>, <,, 1>, < , 1>}");
+    std::istringstream is4(os4.str());
+    multiset<char, decr_char, equal_char> m4;
+    m4.parse(is4);
+    assert(m3 == m4);
+
+    multiset<custom_int, decr_custom_int, equal_custom_int> m5;
+    m5.add(custom_int(4));
+    m5.add(custom_int(4));
+    std::ostringstream os5;
+    m5.format(os5);
+    assert(os5.str() == "{<4, 2>}");
+
+    // i valori letti con l'operatore >> si fermano al separatore
+    multiset<std::string, cresc_string, equal_string> words;
+    words.add("abc");
+    words.add("de");
+    words.add("de");
+    std::ostringstream os6;
+    words.format(os6);
+    assert(os6.str() == "{<abc, 1>, <de, 2>}");
+    std::istringstream is6(os6.str());
+    multiset<std::string, cresc_string, equal_string> words2;
+    words2.parse(is6);
+    assert(words2 == words);
+    std::istringstream is7("{<two words, 1>}");
+    bool split = false;
+    try {
+        words2.parse(is7);
+    } catch (invalid_format_exception &) {
+        split = true;
+    }
+    assert(split);
+    assert(words2 == words);
+
+    const char *invalid[] = {"", "{<1, 2>", "{<1 2>}", "{<1, 0>}", "{<x, 1>}", "<1, 1>}"};
+    for (const char *text : invalid) {
+        std::istringstream bad(text);
+        bool thrown = false;
+        try {
+            m.parse(bad);
+        } catch (invalid_format_exception &) {
+            thrown = true;
+        }
+        assert(thrown);
+        assert(m.size() == 5);
+    }
+}
+
+/** 
+    @brief test della costruzione di un multiset su disco tramite run e merge
+*/
+void test_external_builder() {
+    multiset<int, decr_int, equal_int> expected;
+    // budget di circa tre valori distinti per run
+    external_multiset_builder<int, decr_int, equal_int> builder(100, 64);
+    for (int i = 0; i < 200; ++i) {
+        int value = (i * 37) % 23 - 11;
+        builder.add(value);
+        expected.add(value);
+    }
+    assert(builder.size() == 200);
+    assert(builder.runs() > 1);
+
+    const char *path = "test_external_builder.bin";
+    builder.finish(path);
+    assert(builder.runs() == 0);
+    {
+        mapped_multiset<int, decr_int, equal_int> mm(path);
+        assert(mm.size() == 200);
+        assert(mm.distinct() == 23);
+        multiset<int, decr_int, equal_int>::const_iterator it = expected.begin();
+        mapped_multiset<int, decr_int, equal_int>::const_iterator it2 = mm.begin();
+        for (; it != expected.end(); ++it, ++it2) {
+            assert(*it == *it2);
+            assert(it.occurrences() == it2.occurrences());
+        }
+        assert(it2 == mm.end());
+    }
+
+    int values[] = {5, 1, 5, 9, 1, 5};
+    builder.add(values, values + 6);
+    builder.finish(path, multiset_io::layout_compact);
+    std::ifstream in(path, std::ios::binary);
+    multiset<int, decr_int, equal_int> m;
+    m.deserialize(in);
+    multiset<int, decr_int, equal_int> m2(values, values + 6);
+    assert(m == m2);
+    std::remove(path);
+}
+
+/** 
+    @brief test d'uso del multiset a bitmap compressa
+*/
+void test_bitmap_multiset() {
+    bitmap_multiset<int> m;
+    m.add(8);
+    m.add(-1);
+    m.add(2);
+    m.add(2);
+    m.add(70000);
+    m.add(2);
+    assert(m.size() == 6);
+    assert(m.distinct() == 4);
+    assert(m.getOccurrences(2) == 3);
+    assert(m.getOccurrences(-1) == 1);
+    assert(m.getOccurrences(3) == 0);
+    assert(m.contains(70000));
+    assert(!m.contains(70001));
+
+    bitmap_multiset<int>::const_iterator it = m.begin();
+    assert(*it == -1);
+    ++it;
+    assert(*it == 2);
+    assert(it.occurrences() == 3);
+    ++it;
+    ++it;
+    ++it;
+    assert(*it == 8);
+    ++it;
+    assert(*it == 70000);
+    ++it;
+    assert(it == m.end());
+
+    std::ostringstream os;
+    os << m;
+    assert(os.str() == "{<-1, 1>, <2, 3>, <8, 1>, <70000, 1>}\n");
+
+    m.remove(2);
+    m.remove(-1);
+    assert(m.size() == 4);
+    assert(!m.contains(-1));
+    bool thrown = false;
+    try {
+        m.remove(-1);
+    } catch (element_not_found_exception &) {
+        thrown = true;
+    }
+    assert(thrown);
+
+    // insieme denso: i contenitori diventano bitmap
+    bitmap_multiset<int> dense;
+    multiset<int, cresc_int, equal_int> reference;
+    for (int i = 0; i < 20000; ++i) {
+        dense.add(i);
+        if (i % 3 == 0) {
+            dense.add(i);
+        }
+    }
+    for (int i = 0; i < 300; ++i) {
+        dense.add(5);
+    }
+    assert(dense.distinct() == 20000);
+    assert(dense.getOccurrences(5) == 301);
+    assert(dense.getOccurrences(6) == 2);
+    assert(dense.getOccurrences(7) == 1);
+    assert(dense.memory_usage() < 20000 * 4);
+    for (int i = 0; i < 300; ++i) {
+        dense.remove(5);
+    }
+    assert(dense.getOccurrences(5) == 1);
+    for (int i = 0; i < 19000; ++i) {
+        dense.remove(i);
+    }
+    assert(dense.distinct() == 6334 + 1000);
+    assert(dense.getOccurrences(19500) == 2);
+    assert(dense.getOccurrences(19501) == 1);
+    multiset<int, cresc_int, equal_int> copy(dense.begin(), dense.end());
+    assert(static_cast<std::uint64_t>(copy.size()) == dense.size());
+
+    // operazioni insiemistiche
+    int a_values[] = {1, 1, 2, 3, 3, 3, 100000};
+    int b_values[] = {1, 3, 4, 4, 100000, 100000};
+    bitmap_multiset<int> a(a_values, a_values + 7);
+    bitmap_multiset<int> b(b_values, b_values + 6);
+    bitmap_multiset<int> u = a.unite(b);
+    assert(u.size() == 2 + 1 + 3 + 2 + 2);
+    assert(u.getOccurrences(4) == 2);
+    bitmap_multiset<int> i = a.intersect(b);
+    assert(i.size() == 3);
+    assert(i.getOccurrences(1) == 1);
+    assert(i.getOccurrences(3) == 1);
+    assert(i.getOccurrences(100000) == 1);
+    bitmap_multiset<int> d = a.subtract(b);
+    assert(d.size() == 4);
+    assert(d.getOccurrences(1) == 1);
+    assert(d.getOccurrences(3) == 2);
+    assert(!d.contains(100000));
+    assert(a.subtract(a).isEmpty());
+    assert(a.unite(a) == a);
+    assert(a.intersect(b) != a);
+}
+
+/** 
+    @brief test d'uso del multiset con nodi interni (small buffer)
+*/
+void test_inline_nodes() {
+    multiset<int, decr_int, equal_int, unsigned int, 4> m;
+    m.add(3);
+    m.add(1);
+    m.add(3);
+    m.add(2);
+    assert(m.size() == 4);
+    assert(m.getOccurrences(3) == 2);
+
+    // oltre la capacita' interna i nodi finiscono sullo heap
+    for (int i = 10; i < 20; ++i) {
+        m.add(i);
+    }
+    assert(m.size() == 14);
+    m.remove(1);
+    m.remove(2);
+    m.add(25);
+    m.add(0);
+    assert(m.size() == 14);
+    multiset<int, decr_int, equal_int> reference;
+    reference.add(3);
+    reference.add(3);
+    reference.add(25);
+    reference.add(0);
+    for (int i = 10; i < 20; ++i) {
+        reference.add(i);
+    }
+    assert(m == reference);
+
+    multiset<int, decr_int, equal_int, unsigned int, 4> copy(m);
+    assert(copy == m);
+    copy.remove(3);
+    assert(copy != m);
+    copy = m;
+    assert(copy == m);
+
+    multiset<int, decr_int, equal_int, unsigned int, 4> moved(std::move(copy));
+    assert(moved == m);
+    assert(copy.isEmpty());
+    copy.add(7);
+    assert(copy.size() == 1);
+    copy = std::move(moved);
+    assert(copy == m);
+    assert(moved.isEmpty());
+
+    std::stringstream ss;
+    m.serialize(ss);
+    multiset<int, decr_int, equal_int, unsigned int, 4> loaded;
+    loaded.add(1);
+    loaded.deserialize(ss);
+    assert(loaded == m);
+
+    // un parse fallito libera correttamente i nodi interni del multiset temporaneo
+    std::stringstream text;
+    m.format(text);
+    loaded.parse(text);
+    assert(loaded == m);
+    std::istringstream bad("{<1, 1>, <2, 1>, <3, x>}");
+    bool thrown = false;
+    try {
+        loaded.parse(bad);
+    } catch (invalid_format_exception &) {
+        thrown = true;
+    }
+    assert(thrown);
+    assert(loaded == m);
+
+    m.clear();
+    assert(m.isEmpty());
+    m.add(5);
+    assert(m.getOccurrences(5) == 1);
+
+    multiset<custom_int, decr_custom_int, equal_custom_int, unsigned int, 2> mc;
+    mc.add(custom_int(1));
+    mc.add(custom_int(2));
+    mc.add(custom_int(3));
+    mc.remove(custom_int(1));
+    mc.add(custom_int(4));
+    assert(mc.size() == 3);
+    assert(mc.contains(custom_int(4)));
+    assert(!mc.contains(custom_int(1)));
+}
+
+/** 
+    @brief un valore nuovo aggiunto a un multiset saturo viene ignorato, senza nodi a occorrenze incoerenti
+*/
+template <typename M>
+void check_saturated_new_value(M &m) {
+    for (int i = 0; i < 255; ++i) {
+        m.add(1);
+    }
+    m.add(2);
+    assert(m.size() == 255);
+    assert(!m.contains(2));
+    assert(m.getOccurrences(2) == 0);
+    m.remove(1);
+    assert(m.size() == 254);
+    unsigned int n = 0;
+    for (typename M::const_iterator it = m.begin(); it != m.end(); ++it) {
+        ++n;
+    }
+    assert(n == 254);
+}
+
+/** 
+    @brief test d'uso dei tipi di contatore configurabili
+*/
+void test_count_types() {
+    multiset<int, decr_int, equal_int, std::uint8_t> small;
+    for (int i = 0; i < 255; ++i) {
+        small.add(1);
+    }
+    assert(small.getOccurrences(1) == 255);
+    assert(small.size() == 255);
+
+    multiset<int, decr_int, equal_int, saturating_count<std::uint8_t> > saturating;
+    for (int i = 0; i < 300; ++i) {
+        saturating.add(1);
+    }
+    assert(saturating.getOccurrences(1) == 255);
+    assert(saturating.size() == 255);
+    saturating.remove(1);
+    assert(saturating.getOccurrences(1) == 254);
+    multiset<int, decr_int, equal_int, saturating_count<std::uint8_t> > full;
+    check_saturated_new_value(full);
+    full.add(1);
+    assert(full.add(full.begin(), 3) == full.end());
+    ranked_multiset<int, decr_int, equal_int, saturating_count<std::uint8_t> > full_ranked;
+    check_saturated_new_value(full_ranked);
+    skiplist_multiset<int, cresc_int, equal_int, saturating_count<std::uint8_t> > full_skiplist;
+    check_saturated_new_value(full_skiplist);
+    unrolled_multiset<int, cresc_int, equal_int, saturating_count<std::uint8_t> > full_unrolled;
+    check_saturated_new_value(full_unrolled);
+    fixed_multiset<int, cresc_int, equal_int, 4, saturating_count<std::uint8_t> > full_fixed;
+    check_saturated_new_value(full_fixed);
+
+    multiset<int, decr_int, equal_int, checked_count<std::uint8_t> > checked;
+    for (int i = 0; i < 250; ++i) {
+        checked.add(i);
+    }
+    for (int i = 0; i < 5; ++i) {
+        checked.add(7);
+    }
+    assert(checked.size() == 255);
+    bool thrown = false;
+    try {
+        checked.add(7);
+    } catch (count_overflow_exception &) {
+        thrown = true;
+    }
+    assert(thrown);
+    thrown = false;
+    try {
+        checked.add(1000);
+    } catch (count_overflow_exception &) {
+        thrown = true;
+    }
+    assert(thrown);
+    assert(checked.size() == 255);
+    assert(checked.getOccurrences(7) == 6);
+    assert(!checked.contains(1000));
+
+    multiset<int, decr_int, equal_int, std::uint64_t> big;
+    std::istringstream is("{<1, 5000000000>, <0, 3>}");
+    big.parse(is);
+    assert(big.size() == 5000000003ULL);
+    assert(big.getOccurrences(1) == 5000000000ULL);
+    std::stringstream ss;
+    big.serialize(ss);
+    multiset<int, decr_int, equal_int> narrow;
+    thrown = false;
+    try {
+        narrow.deserialize(ss);
+    } catch (invalid_format_exception &) {
+        thrown = true;
+    }
+    assert(thrown);
+
+    std::ostringstream os;
+    small.clear();
+    small.add(65);
+    small.format(os);
+    assert(os.str() == "{<65, 1>}");
+}
+
+/** 
+    @brief test d'uso del multiset approssimato
+*/
+void test_approx_multiset() {
+    approx_multiset<int, std::hash<int>, equal_int> a(0.01, 0.01, 32);
+    approx_multiset<int, std::hash<int>, equal_int> b(0.01, 0.01, 32);
+    multiset<int, decr_int, equal_int> exact;
+    // pochi valori molto frequenti e una lunga coda di valori rari
+    for (int i = 0; i < 20000; ++i) {
+        int value = i % 4 == 0 ? i % 5 : 1000 + i % 2000;
+        if (i % 2 == 0) {
+            a.add(value);
+        } else {
+            b.add(value);
+        }
+        exact.add(value);
+    }
+    std::size_t memory = a.memory_usage();
+    a.merge(b);
+    assert(a.memory_usage() == memory);
+    assert(a.size() == 20000);
+
+    int over = 0;
+    for (multiset<int, decr_int, equal_int>::const_iterator it = exact.begin(); it != exact.end(); ++it) {
+        std::uint64_t estimate = a.getOccurrences(*it);
+        assert(estimate >= it.occurrences());
+        if (estimate > it.occurrences() + 0.01 * 20000) {
+            ++over;
+        }
+        assert(a.contains(*it));
+    }
+    assert(over == 0);
+
+    std::vector<std::pair<int, std::uint64_t> > top = a.top_k(5);
+    assert(top.size() == 5);
+    for (std::size_t i = 0; i < top.size(); ++i) {
+        assert(top[i].first >= 0 && top[i].first < 5);
+        assert(top[i].second >= 1000);
+    }
+
+    bool thrown = false;
+    try {
+        approx_multiset<int, std::hash<int>, equal_int> c(0.1, 0.01, 32);
+        a.merge(c);
+    } catch (std::invalid_argument &) {
+        thrown = true;
+    }
+    assert(thrown);
+
+    // fondere un multiset con se stesso raddoppia i conteggi
+    std::vector<std::pair<int, std::uint64_t> > before = a.top_k(5);
+    a.merge(a);
+    assert(a.size() == 40000);
+    std::vector<std::pair<int, std::uint64_t> > doubled = a.top_k(5);
+    assert(doubled.size() == 5);
+    for (std::size_t i = 0; i < doubled.size(); ++i) {
+        assert(doubled[i].first == before[i].first);
+        assert(doubled[i].second == 2 * before[i].second);
+    }
+
+    a.clear();
+    assert(a.isEmpty());
+    assert(!a.contains(1));
+    assert(a.top_k(3).empty());
+}
+
+
+/** 
+    @brief test di merge e subtract tra multiset
+*/
+void test_merge_subtract() {
+    multiset<int, decr_int, equal_int> a;
+    multiset<int, decr_int, equal_int> b;
+    a.add(1); a.add(3); a.add(3); a.add(7);
+    b.add(0); b.add(3); b.add(5); b.add(7); b.add(9);
+    a.merge(b);
+    assert(a.size() == 9);
+    assert(a.getOccurrences(0) == 1);
+    assert(a.getOccurrences(3) == 3);
+    assert(a.getOccurrences(7) == 2);
+    assert(a.getOccurrences(9) == 1);
+    int prev = 100;
+    for (multiset<int, decr_int, equal_int>::const_iterator it = a.begin(); it != a.end(); ++it) {
+        assert(*it <= prev);
+        prev = *it;
+    }
+
+    a.subtract(b);
+    assert(a.size() == 4);
+    assert(!a.contains(0));
+    assert(!a.contains(9));
+    assert(a.getOccurrences(3) == 2);
+    assert(a.getOccurrences(7) == 1);
+
+    // una sottrazione non valida non modifica il multiset
+    b.add(3); b.add(3);
+    bool thrown = false;
+    try {
+        a.subtract(b);
+    } catch (element_not_found_exception &) {
+        thrown = true;
+    }
+    assert(thrown);
+    assert(a.size() == 4);
+    assert(a.getOccurrences(3) == 2);
+
+    a.subtract(a);
+    assert(a.isEmpty());
+}
+
+/** 
+    @brief test d'uso del multiset a finestra scorrevole
+*/
+void test_windowed_multiset() {
+    // finestra di 60 secondi divisa in bucket da 10
+    windowed_multiset<int, decr_int, equal_int> w(60, 6);
+    for (std::uint64_t t = 0; t < 60; ++t) {
+        w.add(static_cast<int>(t % 3), t);
+    }
+    assert(w.size() == 60);
+    assert(w.getOccurrences(0) == 20);
+    assert(w.contains(2));
+
+    // al secondo 65 il bucket [0, 10) e' scaduto
+    w.advance(65);
+    assert(w.size() == 50);
+    assert(w.getOccurrences(1) == 17);
+
+    // un evento in ritardo ma ancora nella finestra viene contato, uno troppo vecchio no
+    assert(w.add(7, 15));
+    assert(!w.add(7, 5));
+    assert(w.getOccurrences(7) == 1);
+    w.advance(69);
+    assert(w.getOccurrences(7) == 1);
+    w.advance(70);
+    assert(!w.contains(7));
+    assert(w.size() == 40);
+
+    multiset<int, decr_int, equal_int> s = w.snapshot();
+    assert(s.size() == w.size());
+    assert(s.getOccurrences(0) == w.getOccurrences(0));
+
+    // dopo un salto piu' lungo della finestra non resta nulla
+    w.advance(1000);
+    assert(w.isEmpty());
+
+    // finestra sugli ultimi 4 inserimenti, con bucket da 2
+    windowed_multiset<int, decr_int, equal_int> last(4, 2);
+    for (int i = 0; i < 10; ++i) {
+        last.add(i % 2);
+        assert(last.size() <= 4);
+        assert(last.size() >= static_cast<unsigned int>(i < 2 ? i + 1 : 3));
+    }
+    assert(last.size() == 4);
+    assert(last.getOccurrences(0) == 2);
+    assert(last.getOccurrences(1) == 2);
+
+    bool thrown = false;
+    try {
+        windowed_multiset<int, decr_int, equal_int> bad(3, 4);
+    } catch (std::invalid_argument &) {
+        thrown = true;
+    }
+    assert(thrown);
+}
+
+
+/** 
+    @brief test d'uso del multiset con indice delle frequenze
+*/
+void test_ranked_multiset() {
+    ranked_multiset<int, decr_int, equal_int> r;
+    bool thrown = false;
+    try {
+        r.most_frequent();
+    } catch (element_not_found_exception &) {
+        thrown = true;
+    }
+    assert(thrown);
+
+    // il valore i compare i volte
+    for (int i = 1; i <= 10; ++i) {
+        for (int j = 0; j < i; ++j) {
+            r.add(i);
+        }
+    }
+    assert(r.size() == 55);
+    assert(r.distinct() == 10);
+    assert(r.most_frequent() == 10);
+    std::vector<std::pair<int, unsigned int> > top = r.top_k(3);
+    assert(top.size() == 3);
+    assert(top[0].first == 10 && top[0].second == 10);
+    assert(top[1].first == 9 && top[1].second == 9);
+    assert(top[2].first == 8 && top[2].second == 8);
+    assert(r.top_k(100).size() == 10);
+
+    // le occorrenze cambiano e la classifica segue
+    r.add(1); r.add(1); r.add(1); r.add(1); r.add(1); r.add(1); r.add(1); r.add(1); r.add(1); r.add(1);
+    assert(r.getOccurrences(1) == 11);
+    assert(r.most_frequent() == 1);
+    r.remove(10);
+    r.remove(10);
+    top = r.top_k(2);
+    assert(top[0].first == 1);
+    assert(top[1].first == 9);
+
+    for (int j = 0; j < 11; ++j) {
+        r.remove(1);
+    }
+    assert(!r.contains(1));
+    assert(r.distinct() == 9);
+    assert(r.most_frequent() == 9);
+
+    ranked_multiset<int, decr_int, equal_int> copy(r);
+    r.clear();
+    assert(r.isEmpty());
+    assert(copy.most_frequent() == 9);
+    assert(copy.top_k(9).back().second == 2);
+    int prev = 100;
+    unsigned int n = 0;
+    for (ranked_multiset<int, decr_int, equal_int>::const_iterator it = copy.begin(); it != copy.end(); ++it) {
+        assert(*it <= prev);
+        prev = *it;
+        ++n;
+    }
+    assert(n == copy.size());
+
+    thrown = false;
+    try {
+        copy.remove(42);
+    } catch (element_not_found_exception &) {
+        thrown = true;
+    }
+    assert(thrown);
+    r = copy;
+    assert(r.top_k(1)[0].first == 9);
+}
+
+
+/** 
+    @brief test dei quantili e dell'istogramma
+*/
+void test_quantiles() {
+    multiset<int, cresc_int, equal_int> latencies;
+    for (int i = 1; i <= 100; ++i) {
+        latencies.add(i);
+    }
+    assert(latencies.quantile(0) == 1);
+    assert(latencies.quantile(0.5) == 50);
+    assert(latencies.quantile(0.99) == 99);
+    assert(latencies.quantile(1) == 100);
+
+    for (int i = 0; i < 100; ++i) {
+        latencies.add(10);
+    }
+    assert(latencies.quantile(0.5) == 10);
+    std::vector<int> q = latencies.quantiles({0.99, 0.5, 0.01, 0.9});
+    assert(q.size() == 4);
+    assert(q[0] == 98);
+    assert(q[1] == 10);
+    assert(q[2] == 2);
+    assert(q[3] == 80);
+
+    std::vector<unsigned int> h = latencies.histogram({10, 50, 90});
+    assert(h.size() == 4);
+    assert(h[0] == 9);
+    assert(h[1] == 140);
+    assert(h[2] == 40);
+    assert(h[3] == 11);
+    assert(latencies.histogram(std::vector<int>())[0] == latencies.size());
+
+    // nell'ordine decrescente i quantili seguono l'ordine di iterazione
+    multiset<int, decr_int, equal_int> desc;
+    desc.add(1); desc.add(2); desc.add(3); desc.add(4);
+    assert(desc.quantile(0.25) == 4);
+    assert(desc.histogram({3})[0] == 1);
+
+    bool thrown = false;
+    try {
+        latencies.quantile(1.5);
+    } catch (std::invalid_argument &) {
+        thrown = true;
+    }
+    assert(thrown);
+    thrown = false;
+    try {
+        multiset<int, cresc_int, equal_int> empty;
+        empty.quantile(0.5);
+    } catch (element_not_found_exception &) {
+        thrown = true;
+    }
+    assert(thrown);
+}
+
+
+/** 
+    @brief test del campionamento pesato
+*/
+void test_sample() {
+    std::mt19937_64 rng(42);
+    multiset<int, decr_int, equal_int> m;
+    // 1 ha peso 1, 2 peso 2, ..., 4 peso 4
+    for (int i = 1; i <= 4; ++i) {
+        for (int j = 0; j < i; ++j) {
+            m.add(i);
+        }
+    }
+    alias_sampler<int> frozen = m.sampler();
+    assert(frozen.size() == 4);
+    assert(frozen.total() == 10);
+
+    int dynamic_hits[5] = {0, 0, 0, 0, 0};
+    int frozen_hits[5] = {0, 0, 0, 0, 0};
+    for (int i = 0; i < 10000; ++i) {
+        ++dynamic_hits[m.sample(rng)];
+        ++frozen_hits[frozen.sample(rng)];
+    }
+    std::vector<int> batch = m.sample_n(rng, 10000);
+    assert(batch.size() == 10000);
+    int batch_hits[5] = {0, 0, 0, 0, 0};
+    std::size_t changes = 0;
+    for (std::size_t i = 0; i < batch.size(); ++i) {
+        ++batch_hits[batch[i]];
+        if (i > 0 && batch[i] != batch[i - 1]) {
+            ++changes;
+        }
+    }
+    // le estrazioni non sono raggruppate per valore (attese circa 7000 alternanze)
+    assert(changes > 6000);
+    std::vector<int> frozen_batch = frozen.sample_n(rng, 100);
+    assert(frozen_batch.size() == 100);
+    assert(dynamic_hits[0] == 0 && frozen_hits[0] == 0 && batch_hits[0] == 0);
+    for (int i = 1; i <= 4; ++i) {
+        // atteso 1000 * i, con ampio margine
+        assert(dynamic_hits[i] > 800 * i && dynamic_hits[i] < 1200 * i);
+        assert(frozen_hits[i] > 800 * i && frozen_hits[i] < 1200 * i);
+        assert(batch_hits[i] > 800 * i && batch_hits[i] < 1200 * i);
+    }
+
+    // il campionatore dinamico segue le modifiche
+    m.remove(4); m.remove(4); m.remove(4); m.remove(4);
+    for (int i = 0; i < 1000; ++i) {
+        assert(m.sample(rng) != 4);
+    }
+
+    multiset<int, decr_int, equal_int> empty;
+    assert(empty.sample_n(rng, 0).empty());
+    bool thrown = false;
+    try {
+        empty.sample(rng);
+    } catch (element_not_found_exception &) {
+        thrown = true;
+    }
+    assert(thrown);
+    thrown = false;
+    try {
+        empty.sampler().sample(rng);
+    } catch (element_not_found_exception &) {
+        thrown = true;
+    }
+    assert(thrown);
+}
+
+
+/** 
+    @brief test delle statistiche sulle operazioni del multiset
+*/
+void test_stats() {
+    // senza statistiche il multiset non cresce
+    assert(sizeof(multiset<int, decr_int, equal_int>) ==
+           sizeof(multiset<int, decr_int, equal_int, unsigned int, 0, no_stats>));
+    assert(sizeof(multiset<int, decr_int, equal_int>) < sizeof(multiset<int, decr_int, equal_int, unsigned int, 0, counting_stats>));
+
+    multiset<int, decr_int, equal_int, unsigned int, 0, counting_stats> m;
+    m.add(1);
+    m.add(2);
+    m.add(3);
+    assert(m.stats().allocations == 3);
+    assert(m.stats().lookups == 3);
+    m.add(2);
+    // il duplicato non alloca
+    assert(m.stats().allocations == 3);
+
+    m.reset_stats();
+    assert(m.stats().comparisons == 0 && m.stats().lookups == 0);
+    assert(m.getOccurrences(1) == 1);
+    // la lista e' 3, 2, 1: due salti per arrivare a 1
+    assert(m.stats().lookups == 1);
+    assert(m.stats().hops == 2);
+    assert(m.stats().equalities == 3);
+    assert(m.stats().hops_per_lookup() == 2);
+
+    bool thrown = false;
+    try {
+        m.remove(42);
+    } catch (element_not_found_exception &) {
+        thrown = true;
+    }
+    assert(thrown);
+    assert(m.stats().not_found == 1);
+    m.remove(3);
+    assert(m.stats().deallocations == 1);
+
+    // le statistiche non influiscono sul confronto con multiset senza statistiche
+    multiset<int, decr_int, equal_int> plain;
+    plain.add(1);
+    plain.add(2);
+    plain.add(2);
+    assert(m == plain);
+
+    multiset<int, decr_int, equal_int, unsigned int, 2, counting_stats> small;
+    small.add(1);
+    small.add(2);
+    small.add(3);
+    // solo il terzo nodo va sullo heap
+    assert(small.stats().allocations == 1);
+}
+
+
+/** 
+    @brief test di memory_usage, distinct_count e compact
+*/
+void test_memory_usage() {
+    multiset<int, decr_int, equal_int, unsigned int, 0, counting_stats> m;
+    assert(m.memory_usage().total() == 0);
+    for (int i = 0; i < 1000; ++i) {
+        m.add(i % 100);
+    }
+    assert(m.size() == 1000);
+    assert(m.distinct_count() == 100);
+    multiset_memory before = m.memory_usage();
+    assert(before.nodes == 100);
+    assert(before.heap_nodes == 100);
+    assert(before.node_bytes > 0 && before.overhead_bytes > 0);
+
+    // molti add e remove lasciano nodi sparsi sullo heap
+    for (int i = 0; i < 100; i += 2) {
+        for (int j = 0; j < 10; ++j) {
+            m.remove(i);
+        }
+    }
+    assert(m.distinct_count() == 50);
+    m.reset_stats();
+    m.compact();
+    multiset_memory after = m.memory_usage();
+    assert(after.nodes == 50);
+    assert(after.heap_nodes == 0);
+    assert(after.total() < before.total() / 2);
+    assert(m.stats().allocations == 1);
+    assert(m.stats().deallocations == 50);
+    assert(m.size() == 500);
+    int prev = 100;
+    for (multiset<int, decr_int, equal_int, unsigned int, 0, counting_stats>::const_iterator it = m.begin(); it != m.end(); ++it) {
+        assert(*it < prev || *it == prev);
+        assert(*it % 2 == 1);
+        prev = *it;
+    }
+
+    // un secondo compact non fa nulla
+    m.compact();
+    assert(m.stats().allocations == 1);
+
+    // i nodi aggiunti dopo vanno sullo heap, quelli rimossi liberano slot del blocco
+    m.add(1000);
+    m.remove(99);
+    m.remove(99);
+    m.remove(99);
+    m.remove(99);
+    m.remove(99);
+    m.remove(99);
+    m.remove(99);
+    m.remove(99);
+    m.remove(99);
+    m.remove(99);
+    assert(m.memory_usage().heap_nodes == 1);
+    m.shrink_to_fit();
+    assert(m.memory_usage().heap_nodes == 0);
+    assert(m.getOccurrences(1000) == 1);
+    assert(!m.contains(99));
+
+    // il blocco segue i nodi nelle copie e negli spostamenti
+    multiset<int, decr_int, equal_int, unsigned int, 0, counting_stats> copy(m);
+    assert(copy == m);
+    multiset<int, decr_int, equal_int, unsigned int, 0, counting_stats> moved(std::move(m));
+    assert(moved == copy);
+    assert(m.isEmpty());
+    moved.clear();
+    assert(moved.memory_usage().total() == 0);
+
+    multiset<int, decr_int, equal_int, unsigned int, 4> small;
+    for (int i = 0; i < 10; ++i) {
+        small.add(i);
+    }
+    small.compact();
+    assert(small.memory_usage().heap_nodes == 0);
+    assert(small.distinct_count() == 10);
+    for (int i = 0; i < 10; ++i) {
+        assert(small.contains(i));
+        small.remove(i);
+    }
+    assert(small.isEmpty());
+}
+
+
+/** 
+    @brief test dell'inserimento con suggerimento e del finger
+*/
+void test_hinted_add() {
+    multiset<int, cresc_int, equal_int, unsigned int, 0, counting_stats> m;
+    // valori in ordine: ogni add riparte dall'ultimo nodo inserito
+    for (int i = 0; i < 1000; ++i) {
+        m.add(i);
+    }
+    assert(m.stats().hops_per_lookup() <= 1);
+    assert(m.size() == 1000);
+    int prev = -1;
+    for (multiset<int, cresc_int, equal_int, unsigned int, 0, counting_stats>::const_iterator it = m.begin(); it != m.end(); ++it) {
+        assert(*it == prev + 1);
+        prev = *it;
+    }
+
+    // un valore che precede il finger riparte dalla testa
+    m.add(-1);
+    assert(m.getOccurrences(-1) == 1);
+    assert(*m.begin() == -1);
+
+    // il finger non sopravvive alla rimozione del suo nodo
+    m.remove(-1);
+    m.add(5);
+    m.remove(5);
+    m.remove(5);
+    m.add(5);
+    assert(m.getOccurrences(5) == 1);
+    m.clear();
+    m.add(3);
+    assert(m.size() == 1);
+
+    multiset<int, cresc_int, equal_int> h;
+    multiset<int, cresc_int, equal_int>::const_iterator it = h.add(h.end(), 10);
+    assert(*it == 10);
+    it = h.add(it, 20);
+    assert(*it == 20);
+    it = h.add(it, 15);
+    assert(*it == 15 && it.occurrences() == 1);
+    // un suggerimento sbagliato viene ignorato
+    it = h.add(it, 5);
+    assert(*it == 5);
+    it = h.emplace_hint(h.begin(), 20);
+    assert(*it == 20 && it.occurrences() == 2);
+    assert(h.size() == 5);
+    int expected[] = {5, 10, 15, 20, 20};
+    int i = 0;
+    for (it = h.begin(); it != h.end(); ++it) {
+        assert(*it == expected[i++]);
+    }
+}
+
+
+/** 
+    @brief test di extract, insert, splice e merge per spostamento
+*/
+void test_node_handles() {
+    typedef multiset<int, decr_int, equal_int, unsigned int, 0, counting_stats> counted;
+    counted a;
+    counted b;
+    for (int i = 0; i < 10; ++i) {
+        a.add(i);
+        a.add(i);
+        if (i % 2 == 0) {
+            b.add(i + 100);
+        }
+    }
+
+    counted::node_handle nh = a.extract(3);
+    assert(!nh.empty());
+    assert(nh.value() == 3 && nh.occurrences() == 2);
+    assert(!a.contains(3));
+    assert(a.size() == 18);
+    assert(a.extract(42).empty());
+
+    // il nodo passa a b senza allocazioni
+    b.reset_stats();
+    counted::const_iterator it = b.insert(std::move(nh));
+    assert(nh.empty());
+    assert(*it == 3 && it.occurrences() == 2);
+    assert(b.stats().allocations == 0);
+    assert(b.getOccurrences(3) == 2);
+    assert(b.size() == 7);
+
+    // un valore gia' presente somma le occorrenze
+    nh = a.extract(4);
+    nh.value() = 3;
+    it = b.insert(std::move(nh));
+    assert(it.occurrences() == 4);
+    assert(b.size() == 9);
+    assert(b.insert(counted::node_handle()) == b.end());
+
+    // splice ricollega i nodi di b in a
+    a.reset_stats();
+    b.reset_stats();
+    a.splice(b);
+    assert(b.isEmpty());
+    assert(a.size() == 25);
+    assert(a.getOccurrences(3) == 4);
+    assert(a.getOccurrences(108) == 1);
+    assert(a.stats().allocations == 0);
+    assert(b.stats().deallocations == 0);
+    int prev = 1000;
+    unsigned int n = 0;
+    for (it = a.begin(); it != a.end(); ++it) {
+        assert(*it <= prev);
+        prev = *it;
+        ++n;
+    }
+    assert(n == a.size());
+
+    // merge per spostamento somma i valori comuni liberando i nodi dell'altro
+    counted c;
+    c.add(0);
+    c.add(50);
+    c.add(200);
+    a.merge(std::move(c));
+    assert(c.isEmpty());
+    assert(a.getOccurrences(0) == 3);
+    assert(a.getOccurrences(50) == 1);
+    assert(a.getOccurrences(200) == 1);
+    assert(a.size() == 28);
+    a.splice(a);
+    assert(a.size() == 28);
+
+    // i nodi interni vengono copiati
+    multiset<int, decr_int, equal_int, unsigned int, 2> small;
+    multiset<int, decr_int, equal_int, unsigned int, 2> other;
+    small.add(1);
+    other.add(1);
+    other.add(2);
+    other.add(3);
+    multiset<int, decr_int, equal_int, unsigned int, 2>::node_handle h = other.extract(2);
+    assert(h.value() == 2);
+    small.insert(std::move(h));
+    small.splice(other);
+    assert(other.isEmpty());
+    assert(small.size() == 4);
+    assert(small.getOccurrences(1) == 2);
+    assert(small.getOccurrences(2) == 1);
+    assert(small.getOccurrences(3) == 1);
+}
+
+
+/** 
+    @brief test di erase per iteratore, per intervallo e con predicato
+*/
+void test_erase() {
+    typedef multiset<int, cresc_int, equal_int, unsigned int, 0, counting_stats> counted;
+    counted m;
+    for (int i = 0; i < 10; ++i) {
+        for (int k = 0; k <= i % 3; ++k) {
+            m.add(i);
+        }
+    }
+    assert(m.size() == 19);
+
+    // rimuove le occorrenze dei valori pari scorrendo la lista una volta
+    m.reset_stats();
+    counted::const_iterator it = m.begin();
+    while (it != m.end()) {
+        if (*it % 2 == 0) {
+            it = m.erase(it);
+        } else {
+            ++it;
+        }
+    }
+    assert(m.stats().hops == 0);
+    assert(m.size() == 19 - 10);
+    assert(!m.contains(0) && !m.contains(4) && !m.contains(6));
+    assert(m.getOccurrences(2) == 0);
+    assert(m.getOccurrences(8) == 0);
+    assert(m.getOccurrences(3) == 1);
+    assert(m.getOccurrences(5) == 3);
+
+    // erase_all su un iteratore ritornato da add cerca il precedente dalla testa
+    it = m.add(m.end(), 7);
+    assert(it.occurrences() == 3);
+    it = m.erase_all(it);
+    assert(!m.contains(7));
+    assert(*it == 9);
+    assert(m.size() == 7);
+
+    counted::const_iterator last = m.erase(m.end(), m.end());
+    assert(last == m.end());
+    bool thrown = false;
+    try {
+        m.erase(m.end());
+    } catch (element_not_found_exception &e) {
+        thrown = true;
+    }
+    assert(thrown);
+
+    // intervallo che inizia e finisce a meta' delle occorrenze di un valore
+    counted r;
+    for (int i = 1; i <= 4; ++i) {
+        for (int k = 0; k < 3; ++k) {
+            r.add(i);
+        }
+    }
+    counted::const_iterator first = r.begin();
+    ++first;
+    last = first;
+    for (int k = 0; k < 6; ++k) {
+        ++last;
+    }
+    it = r.erase(first, last);
+    assert(*it == 3);
+    assert(r.size() == 6);
+    assert(r.getOccurrences(1) == 1);
+    assert(r.getOccurrences(2) == 0);
+    assert(r.getOccurrences(3) == 2);
+    assert(r.getOccurrences(4) == 3);
+
+    first = r.begin();
+    ++first;
+    ++first;
+    last = first;
+    ++last;
+    it = r.erase(first, last);
+    assert(*it == 4);
+    assert(r.getOccurrences(3) == 1);
+    it = r.erase(r.begin(), r.end());
+    assert(it == r.end());
+    assert(r.isEmpty());
+
+    // erase_if rimuove tutte le occorrenze e ritorna il numero di elementi rimossi
+    multiset<int, decr_int, equal_int, unsigned int, 4> e;
+    for (int i = 0; i < 12; ++i) {
+        e.add(i % 6);
+    }
+    assert(e.erase_if([](const int &v) { return v % 2 == 1; }) == 6);
+    assert(e.size() == 6);
+    assert(!e.contains(1) && !e.contains(3) && !e.contains(5));
+    assert(e.getOccurrences(4) == 2);
+    assert(e.erase_if([](const int &) { return true; }) == 6);
+    assert(e.isEmpty());
+    e.add(3);
+    assert(e.size() == 1);
+}
+
+
+/** 
+    @brief test della cache delle ricerche
+*/
+void test_mru_cache() {
+    typedef multiset<int, decr_int, equal_int, unsigned int, 0, counting_stats, mru_cache<std::hash<int>, 8> > cached;
+    cached m;
+    for (int i = 0; i < 100; ++i) {
+        m.add(i);
+    }
+    m.reset_stats();
+    m.reset_cache_stats();
+
+    // dopo la prima ricerca i valori caldi non scorrono piu' la lista
+    for (int k = 0; k < 100; ++k) {
+        assert(m.getOccurrences(5) == 1);
+        assert(m.contains(7));
+    }
+    assert(m.cache().misses() == 2);
+    assert(m.cache().hits() == 198);
+    assert(m.stats().hops < 200);
+    for (int k = 0; k < 10; ++k) {
+        m.add(5);
+    }
+    assert(m.getOccurrences(5) == 11);
+    assert(m.cache().hits() == 209);
+
+    // la rimozione dell'ultima occorrenza invalida lo slot
+    for (int k = 0; k < 10; ++k) {
+        m.remove(5);
+    }
+    assert(m.getOccurrences(5) == 1);
+    m.remove(5);
+    assert(m.getOccurrences(5) == 0);
+    assert(!m.contains(5));
+    m.add(5);
+    assert(m.getOccurrences(5) == 1);
+
+    // un nodo estratto non viene piu' trovato dalla cache
+    cached::node_handle nh = m.extract(7);
+    assert(!m.contains(7));
+    cached other;
+    other.insert(std::move(nh));
+    assert(other.getOccurrences(7) == 1);
+    assert(m.getOccurrences(7) == 0);
+
+    // le copie partono con la cache vuota
+    cached copy(m);
+    assert(copy.cache().hits() == 0 && copy.cache().misses() == 0);
+    assert(copy.contains(5));
+    copy.remove(5);
+    assert(m.contains(5) && !copy.contains(5));
+
+    // dopo uno spostamento la cache dell'originale non punta ai nodi spostati
+    cached moved(std::move(copy));
+    assert(!copy.contains(6));
+    assert(moved.contains(6));
+    m.splice(moved);
+    assert(!moved.contains(6) && moved.isEmpty());
+    assert(m.getOccurrences(6) == 2);
+
+    m.erase_if([](const int &v) { return v < 50; });
+    assert(!m.contains(6));
+    m.clear();
+    assert(!m.contains(99));
+
+    multiset<int, decr_int, equal_int> plain;
+    plain.add(1);
+    assert(plain.contains(1));
+    assert(plain.cache().hits() == 0);
+}
+
+
+/** 
+    @brief test di skiplist_multiset confrontato con multiset
+*/
+void test_skiplist_multiset() {
+    skiplist_multiset<int, decr_int, equal_int> s;
+    multiset<int, decr_int, equal_int> m;
+    assert(s.isEmpty());
+    std::mt19937 rng(7);
+    std::uniform_int_distribution<int> dist(0, 499);
+    for (int i = 0; i < 5000; ++i) {
+        int v = dist(rng);
+        s.add(v);
+        m.add(v);
+    }
+    assert(s.size() == m.size());
+    assert(s.distinct() == m.distinct_count());
+
+    // il livello 0 e' nello stesso ordine di multiset
+    multiset<int, decr_int, equal_int>::const_iterator mi = m.begin();
+    for (skiplist_multiset<int, decr_int, equal_int>::const_iterator si = s.begin(); si != s.end(); ++si, ++mi) {
+        assert(mi != m.end());
+        assert(*si == *mi);
+        assert(si.occurrences() == mi.occurrences());
+    }
+    assert(mi == m.end());
+
+    std::stringstream ss1;
+    std::stringstream ss2;
+    ss1 << s;
+    ss2 << m;
+    assert(ss1.str() == ss2.str());
+
+    for (int i = 0; i < 5000; ++i) {
+        int v = dist(rng);
+        assert(s.getOccurrences(v) == m.getOccurrences(v));
+        assert(s.contains(v) == m.contains(v));
+        if (m.contains(v)) {
+            s.remove(v);
+            m.remove(v);
+        }
+    }
+    assert(s.size() == m.size());
+    assert(!s.contains(-1));
+    assert(s.getOccurrences(1000) == 0);
+
+    bool thrown = false;
+    try {
+        s.remove(-1);
+    } catch (element_not_found_exception &e) {
+        thrown = true;
+    }
+    assert(thrown);
+
+    skiplist_multiset<int, decr_int, equal_int> copy(s);
+    assert(copy == s);
+    copy.add(-5);
+    assert(copy != s);
+    assert(copy.getOccurrences(-5) == 1);
+    copy = s;
+    assert(copy == s);
+
+    while (!s.isEmpty()) {
+        s.remove(*s.begin());
+    }
+    assert(s.size() == 0 && s.distinct() == 0);
+    assert(copy.size() == m.size());
+    s.add(3);
+    assert(s.getOccurrences(3) == 1);
+    copy.clear();
+    assert(copy.isEmpty() && copy.begin() == copy.end());
+}
+
+
+/** 
+    @brief test di unrolled_multiset confrontato con multiset
+*/
+void test_unrolled_multiset() {
+    typedef unrolled_multiset<int, cresc_int, equal_int, unsigned int, 8> unrolled;
+    unrolled u;
+    multiset<int, cresc_int, equal_int> m;
+    assert(u.isEmpty() && u.blocks() == 0);
+    std::mt19937 rng(11);
+    std::uniform_int_distribution<int> dist(0, 299);
+    for (int i = 0; i < 3000; ++i) {
+        int v = dist(rng);
+        u.add(v);
+        m.add(v);
+    }
+    assert(u.size() == m.size());
+    assert(u.distinct() == m.distinct_count());
+    // ogni blocco e' pieno almeno per meta' dopo una divisione
+    assert(u.blocks() <= 2 * u.distinct() / 8 + 1);
+
+    multiset<int, cresc_int, equal_int>::const_iterator mi = m.begin();
+    for (unrolled::const_iterator ui = u.begin(); ui != u.end(); ++ui, ++mi) {
+        assert(mi != m.end());
+        assert(*ui == *mi);
+        assert(ui.occurrences() == mi.occurrences());
+    }
+    assert(mi == m.end());
+
+    std::stringstream ss1;
+    std::stringstream ss2;
+    ss1 << u;
+    ss2 << m;
+    assert(ss1.str() == ss2.str());
+
+    unrolled copy(u);
+    assert(copy == u);
+
+    // svuota quasi tutto: i blocchi si uniscono o vengono liberati
+    for (int i = 0; i < 6000; ++i) {
+        int v = dist(rng);
+        assert(u.getOccurrences(v) == m.getOccurrences(v));
+        assert(u.contains(v) == m.contains(v));
+        if (m.contains(v)) {
+            u.remove(v);
+            m.remove(v);
+        }
+    }
+    while (m.size() > 10) {
+        int v = *m.begin();
+        u.remove(v);
+        m.remove(v);
+    }
+    assert(u.size() == 10);
+    assert(u.distinct() == m.distinct_count());
+    assert(u.blocks() <= 4);
+    assert(copy != u);
+
+    // con rimozioni sparse ogni blocco tranne l'ultimo resta pieno almeno per un quarto
+    unrolled sparse;
+    for (int i = 0; i < 64; ++i) {
+        sparse.add(i);
+    }
+    for (int i = 0; i < 64; ++i) {
+        if (i % 8 != 0) {
+            sparse.remove(i);
+        }
+    }
+    assert(sparse.distinct() == 8 && sparse.size() == 8);
+    assert(sparse.blocks() <= 8 / 2 + 1);
+    int expected = 0;
+    for (unrolled::const_iterator it = sparse.begin(); it != sparse.end(); ++it, expected += 8) {
+        assert(*it == expected);
+    }
+    assert(expected == 64);
+
+    bool thrown = false;
+    try {
+        u.remove(-1);
+    } catch (element_not_found_exception &e) {
+        thrown = true;
+    }
+    assert(thrown);
+
+    copy = u;
+    assert(copy == u);
+    copy.clear();
+    assert(copy.isEmpty() && copy.begin() == copy.end() && copy.blocks() == 0);
+
+    // funziona anche con tipi non banali
+    unrolled_multiset<std::string, cresc_string, equal_string, unsigned int, 4> s;
+    const char *words[] = {"mela", "pera", "kiwi", "fico", "uva", "mela", "lime", "noce", "cedro", "pera"};
+    for (std::size_t i = 0; i < 10; ++i) {
+        s.add(words[i]);
+    }
+    assert(s.distinct() == 8);
+    assert(s.getOccurrences("mela") == 2);
+    s.remove("mela");
+    s.remove("mela");
+    s.remove("uva");
+    assert(!s.contains("mela") && !s.contains("uva"));
+    assert(*s.begin() == "cedro");
+}
+
+
+/** 
+    @brief test delle rimozioni con lapidi
+*/
+void test_tombstones() {
+    typedef multiset<int, cresc_int, equal_int, unsigned int, 0, counting_stats> counted;
+    counted m;
+    m.set_tombstone_ratio(1);
+    for (int i = 0; i < 20; ++i) {
+        m.add(i);
+    }
+
+    // il nodo dell'ultima occorrenza resta come lapide, invisibile
+    m.remove(5);
+    m.remove(0);
+    assert(m.tombstones() == 2);
+    assert(m.size() == 18);
+    assert(m.distinct_count() == 18);
+    assert(!m.contains(5) && m.getOccurrences(5) == 0);
+    assert(*m.begin() == 1);
+    unsigned int n = 0;
+    for (counted::const_iterator it = m.begin(); it != m.end(); ++it) {
+        assert(*it != 0 && *it != 5);
+        ++n;
+    }
+    assert(n == 18);
+    std::stringstream ss;
+    ss << m;
+    assert(ss.str().find("<5, 0>") == std::string::npos);
+    assert(ss.str().find("{<1, 1>, ") == 0);
+
+    bool thrown = false;
+    try {
+        m.remove(5);
+    } catch (element_not_found_exception &e) {
+        thrown = true;
+    }
+    assert(thrown);
+    assert(m.extract(5).empty());
+
+    // un valore che va e viene non alloca e non libera memoria
+    m.reset_stats();
+    for (int k = 0; k < 100; ++k) {
+        m.remove(7);
+        m.add(7);
+    }
+    m.add(5);
+    assert(m.stats().allocations == 0 && m.stats().deallocations == 0);
+    assert(m.tombstones() == 1);
+    assert(m.getOccurrences(5) == 1);
+
+    // confronto, copia e serializzazione ignorano le lapidi
+    counted expected;
+    for (int i = 1; i < 20; ++i) {
+        expected.add(i);
+    }
+    assert(m == expected);
+    counted copy(m);
+    assert(copy.tombstones() == 0);
+    assert(copy == expected);
+    std::stringstream bin;
+    m.serialize(bin);
+    counted loaded;
+    loaded.deserialize(bin);
+    assert(loaded == expected);
+
+    // merge e subtract con lapidi da entrambe le parti
+    copy.set_tombstone_ratio(1);
+    copy.remove(3);
+    m.remove(4);
+    m.merge(copy);
+    assert(m.tombstones() == 0);
+    assert(m.getOccurrences(3) == 1 && m.getOccurrences(4) == 1);
+    assert(m.size() == 36);
+    m.subtract(copy);
+    assert(m.getOccurrences(3) == 1 && !m.contains(4));
+
+    // superata la soglia le lapidi vengono liberate tutte insieme
+    m.set_tombstone_ratio(0.25);
+    for (int i = 1; i < 20; ++i) {
+        if (m.contains(i)) {
+            m.remove(i);
+        }
+        assert(m.tombstones() <= counted::min_tombstones || m.tombstones() <= 0.25 * m.size() + 1);
+    }
+    assert(m.isEmpty());
+    assert(m.tombstones() <= counted::min_tombstones);
+    assert(m.begin() == m.end());
+
+    for (int i = 0; i < 10; ++i) {
+        m.add(i);
+    }
+    m.set_tombstone_ratio(2);
+    m.remove(2);
+    m.remove(3);
+    m.remove(4);
+    counted::const_iterator first = m.begin();
+    ++first;
+    counted::const_iterator last = first;
+    ++last;
+    assert(*last == 5);
+    first = m.erase(first, last);
+    assert(*first == 5);
+    assert(m.tombstones() == 0);
+    m.remove(6);
+    m.compact();
+    assert(m.tombstones() == 0 && m.distinct_count() == 5);
+    m.remove(7);
+    m.set_tombstone_ratio(0);
+    assert(m.tombstones() == 0);
+    m.remove(8);
+    assert(m.tombstones() == 0 && m.size() == 3);
+
+    // anche in un multiset che si svuota un valore che va e viene riusa la sua lapide
+    counted churn;
+    churn.set_tombstone_ratio(1);
+    for (int k = 0; k < 100; ++k) {
+        churn.add(1);
+        churn.remove(1);
+    }
+    assert(churn.stats().allocations == 1 && churn.stats().deallocations == 0);
+    assert(churn.isEmpty() && churn.tombstones() == 1);
+
+    // il campionatore ignora le lapidi
+    churn.add(2);
+    alias_sampler<int> sampler = churn.sampler();
+    assert(sampler.size() == 1 && sampler.total() == 1);
+    std::mt19937 rng(3);
+    for (int k = 0; k < 100; ++k) {
+        assert(sampler.sample(rng) == 2);
+    }
+}
+
+
+/** 
+    @brief test di fixed_multiset costruito durante la compilazione
+*/
+void test_fixed_multiset() {
+    typedef fixed_multiset<int, cresc_int, equal_int, 8> codes_t;
+    constexpr codes_t codes = [] {
+        codes_t m;
+        m.add(404, 3);
+        m.add(200, 10);
+        m.add(500);
+        m.add(404);
+        m.add(302, 0);
+        return m;
+    }();
+    static_assert(codes.size() == 15, "");
+    static_assert(codes.distinct() == 3, "");
+    static_assert(codes.getOccurrences(404) == 4, "");
+    static_assert(codes.contains(500) && !codes.contains(302), "");
+    static_assert(*codes.begin() == 200 && codes.begin().occurrences() == 10, "");
+
+    constexpr codes_t small{3, 1, 3, 2};
+    static_assert(small.size() == 4 && small.getOccurrences(3) == 2, "");
+    static_assert(small != codes, "");
+    constexpr codes_t removed = [] {
+        codes_t m{3, 1, 3, 2};
+        m.remove(1);
+        m.remove(3);
+        return m;
+    }();
+    static_assert(removed == codes_t{2, 3}, "");
+
+    // a runtime: stesso ordine e stesse occorrenze di multiset
+    multiset<int, cresc_int, equal_int> m;
+    for (int k = 0; k < 10; ++k) {
+        m.add(200);
+    }
+    for (int k = 0; k < 4; ++k) {
+        m.add(404);
+    }
+    m.add(500);
+    multiset<int, cresc_int, equal_int>::const_iterator mi = m.begin();
+    unsigned int n = 0;
+    for (codes_t::const_iterator it = codes.begin(); it != codes.end(); ++it, ++mi) {
+        assert(*it == *mi);
+        assert(it.occurrences() == mi.occurrences());
+        ++n;
+    }
+    assert(n == 15 && mi == m.end());
+    std::stringstream ss1;
+    std::stringstream ss2;
+    ss1 << codes;
+    ss2 << m;
+    assert(ss1.str() == ss2.str());
+
+    fixed_multiset<int, cresc_int, equal_int, 2> full;
+    full.add(1);
+    full.add(2);
+    full.add(2);
+    bool thrown = false;
+    try {
+        full.add(3);
+    } catch (capacity_exceeded_exception &e) {
+        thrown = true;
+    }
+    assert(thrown);
+    thrown = false;
+    try {
+        full.remove(3);
+    } catch (element_not_found_exception &e) {
+        thrown = true;
+    }
+    assert(thrown);
+    full.remove(1);
+    full.add(3);
+    assert(full.distinct() == 2 && full.size() == 3);
+    full.clear();
+    assert(full.isEmpty() && full.begin() == full.end());
+}
+
+
+/** 
+    @brief test di diff, apply e della registrazione delle variazioni
+*/
+void test_change_tracking() {
+    typedef multiset<int, cresc_int, equal_int> mset;
+    mset a;
+    mset b;
+    for (int i = 0; i < 10; ++i) {
+        a.add(i);
+        a.add(i);
+        b.add(i * 2);
+    }
+    b.add(2);
+
+    // diff riporta solo i valori che cambiano, nell'ordine di Comp
+    mset::delta_type d = diff(a, b);
+    assert(d.size() == 14);
+    assert(d[0].first == 0 && d[0].second == -1);
+    assert(d[1].first == 1 && d[1].second == -2);
+    assert(d[2].first == 3 && d[2].second == -2);
+    assert(d[13].first == 18 && d[13].second == 1);
+    assert(diff(a, a).empty());
+    mset c(a);
+    c.apply(d);
+    assert(c == b);
+    c.apply(diff(b, a));
+    assert(c == a);
+    c.apply(diff(a, mset()));
+    assert(c.isEmpty());
+
+    // variazioni non valide: il multiset resta com'era
+    mset::delta_type unsorted;
+    unsorted.push_back(std::make_pair(3, 1));
+    unsorted.push_back(std::make_pair(1, 1));
+    bool thrown = false;
+    try {
+        c.apply(unsorted);
+    } catch (invalid_format_exception &e) {
+        thrown = true;
+    }
+    assert(thrown);
+    mset::delta_type too_many;
+    too_many.push_back(std::make_pair(1, 1));
+    too_many.push_back(std::make_pair(4, -3));
+    thrown = false;
+    try {
+        b.apply(too_many);
+    } catch (element_not_found_exception &e) {
+        thrown = true;
+    }
+    assert(thrown);
+    assert(b.getOccurrences(1) == 0 && b.getOccurrences(4) == 1);
+
+    // i limiti del contatore sono controllati prima di modificare il multiset
+    typedef multiset<int, cresc_int, equal_int, checked_count<std::uint8_t> > small;
+    small s;
+    for (int i = 0; i < 250; ++i) {
+        s.add(5);
+    }
+    small::delta_type overflow;
+    overflow.push_back(std::make_pair(1, 3));
+    overflow.push_back(std::make_pair(5, 3));
+    thrown = false;
+    try {
+        s.apply(overflow);
+    } catch (count_overflow_exception &) {
+        thrown = true;
+    }
+    assert(thrown);
+    assert(s.size() == 250 && !s.contains(1));
+    small::delta_type wide;
+    wide.push_back(std::make_pair(1, 256));
+    thrown = false;
+    try {
+        s.apply(wide);
+    } catch (invalid_format_exception &) {
+        thrown = true;
+    }
+    assert(thrown);
+    assert(s.size() == 250 && !s.contains(1));
+    overflow.pop_back();
+    s.apply(overflow);
+    assert(s.size() == 253 && s.getOccurrences(1) == 3);
+
+    // una replica segue il multiset applicando le variazioni registrate
+    mset m(a);
+    mset replica(m);
+    m.track_changes(true);
+    assert(m.tracking_changes());
+    m.add(42);
+    m.remove(3);
+    m.remove(3);
+    m.add(3);
+    m.erase(m.begin());
+    m.erase_if([](int x) { return x % 4 == 0; });
+    m.merge(b);
+    mset::delta_type changes = m.take_changes();
+    for (std::size_t i = 1; i < changes.size(); ++i) {
+        assert(changes[i - 1].first < changes[i].first);
+        assert(changes[i].second != 0);
+    }
+    replica.apply(changes);
+    assert(replica == m);
+    assert(m.take_changes().empty());
+
+    m.set_tombstone_ratio(1);
+    m.remove(42);
+    m.add(100);
+    m.subtract(b);
+    replica.apply(m.take_changes());
+    assert(replica == m);
+    m.clear();
+    replica.apply(m.take_changes());
+    assert(replica.isEmpty());
+
+    m.track_changes(false);
+    m.add(1);
+    assert(m.take_changes().empty());
+}
 
 int main() {
     std::cout << "test_constr..." << std::endl;
@@ -943,5 +2883,56 @@ std::cout << "test_isEmpty..." << std::endl;
     test_constructor_iterator_custom();
     std::cout << "test_isEmpty_custom..." << std::endl;
     test_isEmpty_custom();
+
+    std::cout << "test_serialize..." << std::endl;
+    test_serialize();
+    std::cout << "test_deserialize_invalid..." << std::endl;
+    test_deserialize_invalid();
+    std::cout << "test_mapped_multiset..." << std::endl;
+    test_mapped_multiset();
+    std::cout << "test_format_parse..." << std::endl;
+    test_format_parse();
+    std::cout << "test_external_builder..." << std::endl;
+    test_external_builder();
+    std::cout << "test_bitmap_multiset..." << std::endl;
+    test_bitmap_multiset();
+    std::cout << "test_inline_nodes..." << std::endl;
+    test_inline_nodes();
+    std::cout << "test_count_types..." << std::endl;
+    test_count_types();
+    std::cout << "test_approx_multiset..." << std::endl;
+    test_approx_multiset();
+    std::cout << "test_merge_subtract..." << std::endl;
+    test_merge_subtract();
+    std::cout << "test_windowed_multiset..." << std::endl;
+    test_windowed_multiset();
+    std::cout << "test_ranked_multiset..." << std::endl;
+    test_ranked_multiset();
+    std::cout << "test_quantiles..." << std::endl;
+    test_quantiles();
+    std::cout << "test_sample..." << std::endl;
+    test_sample();
+    std::cout << "test_stats..." << std::endl;
+    test_stats();
+    std::cout << "test_memory_usage..." << std::endl;
+    test_memory_usage();
+    std::cout << "test_hinted_add..." << std::endl;
+    test_hinted_add();
+    std::cout << "test_node_handles..." << std::endl;
+    test_node_handles();
+    std::cout << "test_erase..." << std::endl;
+    test_erase();
+    std::cout << "test_mru_cache..." << std::endl;
+    test_mru_cache();
+    std::cout << "test_skiplist_multiset..." << std::endl;
+    test_skiplist_multiset();
+    std::cout << "test_unrolled_multiset..." << std::endl;
+    test_unrolled_multiset();
+    std::cout << "test_tombstones..." << std::endl;
+    test_tombstones();
+    std::cout << "test_fixed_multiset..." << std::endl;
+    test_fixed_multiset();
+    std::cout << "test_change_tracking..." << std::endl;
+    test_change_tracking();
     return 0;
 }
@@ -0,0 +1,325 @@
+#ifndef MAPPED_MULTISET_H
+#define MAPPED_MULTISET_H
+
+#include <ostream>
+#include <algorithm>
+#include <iterator>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <cerrno>
+#include <string>
+#include <system_error>
+#include <type_traits>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include "multiset_io.h"
+#include "invalid_format_exception.h"
+
+/**
+ * @brief Vista in sola lettura su un multiset serializzato e mappato in memoria
+ *
+ * Il file deve essere scritto con multiset::serialize usando il layout piatto.
+ * Le interrogazioni lavorano direttamente sugli array ordinati di chiavi e occorrenze
+ * del file mappato: l'apertura costa O(1) e le pagine sono condivise tra tutti i processi
+ * che mappano lo stesso file.
+ *
+ * @tparam T tipo del dato (trivially copyable)
+ * @tparam Comp funtore di comparazione usato per scrivere il file
+ * @tparam Eq funtore di equivalenza
+ */
+template <typename T, typename Comp, typename Eq>
+class mapped_multiset
+{
+    static_assert(std::is_trivially_copyable<T>::value, "mapped_multiset requires a trivially copyable T");
+    static_assert(alignof(T) <= 8, "mapped_multiset requires alignof(T) <= 8");
+
+    void *_base;
+    std::size_t _length;
+    const T *_keys;
+    const std::uint64_t *_counts;
+    std::size_t _distinct;
+    std::uint64_t _size;
+    Comp _cmp;
+    Eq _eq;
+
+    // Legge un intero a 64 bit little endian dall'header
+    static std::uint64_t load_u64(const unsigned char *p)
+    {
+        std::uint64_t v = 0;
+        for (int i = 0; i < 8; ++i)
+        {
+            v |= static_cast<std::uint64_t>(p[i]) << (8 * i);
+        }
+        return v;
+    }
+
+    // Indice della prima chiave che non precede value nell'ordine di Comp
+    std::size_t lower_index(const T &value) const
+    {
+        const Comp &cmp = _cmp;
+        return std::lower_bound(_keys, _keys + _distinct, value,
+                                [&cmp](const T &key, const T &v) { return cmp(v, key); }) - _keys;
+    }
+
+    // Indice della prima chiave che segue value nell'ordine di Comp
+    std::size_t upper_index(const T &value) const
+    {
+        const Comp &cmp = _cmp;
+        return std::upper_bound(_keys, _keys + _distinct, value,
+                                [&cmp](const T &v, const T &key) { return cmp(key, v); }) - _keys;
+    }
+
+public:
+    /**
+     * @brief Costruttore
+     * Mappa in memoria il file indicato e ne controlla l'header
+     * @param path Percorso del file scritto con il layout piatto
+     * @throw std::system_error se il file non puo' essere aperto o mappato
+     * @throw invalid_format_exception se il file non e' un multiset piatto di tipo T
+     */
+    explicit mapped_multiset(const std::string &path)
+        : _base(nullptr), _length(0), _keys(nullptr), _counts(nullptr), _distinct(0), _size(0)
+    {
+        int fd = ::open(path.c_str(), O_RDONLY);
+        if (fd < 0)
+        {
+            throw std::system_error(errno, std::generic_category(), "Error, cannot open " + path);
+        }
+        struct stat st;
+        if (::fstat(fd, &st) != 0)
+        {
+            int err = errno;
+            ::close(fd);
+            throw std::system_error(err, std::generic_category(), "Error, cannot stat " + path);
+        }
+        _length = static_cast<std::size_t>(st.st_size);
+        if (_length < multiset_io::header_size)
+        {
+            ::close(fd);
+            throw invalid_format_exception("Error, not a serialized multiset");
+        }
+        _base = ::mmap(nullptr, _length, PROT_READ, MAP_SHARED, fd, 0);
+        int err = errno;
+        ::close(fd);
+        if (_base == MAP_FAILED)
+        {
+            _base = nullptr;
+            throw std::system_error(err, std::generic_category(), "Error, cannot map " + path);
+        }
+
+        const unsigned char *p = static_cast<const unsigned char *>(_base);
+        std::uint64_t distinct = load_u64(p + 8);
+        if (std::memcmp(p, multiset_io::magic, sizeof(multiset_io::magic)) != 0 ||
+            p[4] != multiset_io::version || p[5] != multiset_io::layout_flat ||
+            p[6] != multiset_io::key_raw || p[7] != sizeof(T) ||
+            distinct > (_length - multiset_io::header_size) / sizeof(T) ||
+            multiset_io::flat_counts_offset(distinct, sizeof(T)) + distinct * sizeof(std::uint64_t) > _length)
+        {
+            ::munmap(_base, _length);
+            throw invalid_format_exception("Error, file is not a flat multiset of this key type");
+        }
+        _distinct = static_cast<std::size_t>(distinct);
+        _size = load_u64(p + 16);
+        _keys = reinterpret_cast<const T *>(p + multiset_io::header_size);
+        _counts = reinterpret_cast<const std::uint64_t *>(p + multiset_io::flat_counts_offset(distinct, sizeof(T)));
+    }
+
+    mapped_multiset(const mapped_multiset &other) = delete;
+    mapped_multiset &operator=(const mapped_multiset &other) = delete;
+
+    /**
+     * @brief Distruttore
+     * Rimuove la mappatura del file
+     */
+    ~mapped_multiset()
+    {
+        if (_base != nullptr)
+        {
+            ::munmap(_base, _length);
+        }
+    }
+
+    /**
+     * @brief Size
+     * Ritorna il numero totale di elementi (occorrenze comprese)
+     * @return std::uint64_t
+     */
+    std::uint64_t size() const { return _size; }
+
+    /**
+     * @brief Distinct
+     * Ritorna il numero di valori distinti
+     * @return std::size_t
+     */
+    std::size_t distinct() const { return _distinct; }
+
+    /**
+     * @brief Is Empty
+     * Controlla se il multiset e' vuoto
+     */
+    bool isEmpty() const { return _size == 0; }
+
+    /**
+     * @brief Get the Occurrences
+     * Ritorna il numero di occorrenze di un valore con una ricerca binaria
+     * @param value
+     * @return std::uint64_t
+     */
+    std::uint64_t getOccurrences(const T &value) const
+    {
+        std::size_t i = lower_index(value);
+        if (i < _distinct && _eq(_keys[i], value))
+        {
+            return _counts[i];
+        }
+        return 0;
+    }
+
+    /**
+     * @brief Contains
+     * Controlla se un valore e' presente nel multiset
+     * @param value Valore da cercare
+     */
+    bool contains(const T &value) const
+    {
+        std::size_t i = lower_index(value);
+        return i < _distinct && _eq(_keys[i], value);
+    }
+
+    /**
+     * @brief Count Range
+     * Ritorna il numero di elementi compresi tra first e last (inclusi) nell'ordine di Comp
+     * @param first Primo valore dell'intervallo
+     * @param last Ultimo valore dell'intervallo
+     * @return std::uint64_t
+     */
+    std::uint64_t countRange(const T &first, const T &last) const
+    {
+        std::uint64_t total = 0;
+        for (std::size_t i = lower_index(first), e = upper_index(last); i < e; ++i)
+        {
+            total += _counts[i];
+        }
+        return total;
+    }
+
+    /**
+     * @brief Const Iterator
+     * Iteratore costante sugli elementi mappati, con la stessa semantica di multiset::const_iterator
+     */
+    class const_iterator
+    {
+    public:
+        typedef std::forward_iterator_tag iterator_category;
+        typedef T value_type;
+        typedef ptrdiff_t difference_type;
+        typedef const T *pointer;
+        typedef const T &reference;
+
+        const_iterator() : _owner(nullptr), _index(0), _counter(1) {}
+
+        const_iterator &operator++()
+        {
+            if (_counter == _owner->_counts[_index])
+            {
+                ++_index;
+                _counter = 1;
+            }
+            else
+            {
+                _counter++;
+            }
+            return *this;
+        }
+
+        const_iterator operator++(int)
+        {
+            const_iterator tmp(*this);
+            ++*this;
+            return tmp;
+        }
+
+        bool operator==(const const_iterator &other) const
+        {
+            return _index == other._index;
+        }
+
+        bool operator!=(const const_iterator &other) const
+        {
+            return !(*this == other);
+        }
+
+        reference operator*() const
+        {
+            return _owner->_keys[_index];
+        }
+
+        pointer operator->() const
+        {
+            return _owner->_keys + _index;
+        }
+
+        // Ritorna il numero di occorrenze dell'elemento puntato
+        std::uint64_t occurrences() const
+        {
+            return _owner->_counts[_index];
+        }
+
+    private:
+        friend class mapped_multiset;
+        const_iterator(const mapped_multiset *owner, std::size_t index) : _owner(owner), _index(index), _counter(1) {}
+        const mapped_multiset *_owner;
+        std::size_t _index;
+        std::uint64_t _counter;
+    };
+
+    const_iterator begin() const
+    {
+        return const_iterator(this, 0);
+    }
+
+    const_iterator end() const
+    {
+        return const_iterator(this, _distinct);
+    }
+
+    /**
+     * @brief Ritorna un iteratore al primo valore che non precede value
+     */
+    const_iterator lower_bound(const T &value) const
+    {
+        return const_iterator(this, lower_index(value));
+    }
+
+    /**
+     * @brief Ritorna un iteratore al primo valore che segue value
+     */
+    const_iterator upper_bound(const T &value) const
+    {
+        return const_iterator(this, upper_index(value));
+    }
+
+    /**
+     * @brief Operatore <<
+     * Stampa il multiset nello stesso formato di multiset
+     */
+    friend std::ostream &operator<<(std::ostream &os, const mapped_multiset &m)
+    {
+        os << "{";
+        for (std::size_t i = 0; i < m._distinct; ++i)
+        {
+            if (i > 0)
+            {
+                os << ", ";
+            }
+            os << "<" << m._keys[i] << ", " << m._counts[i] << ">";
+        }
+        os << "}" << '\n';
+        return os;
+    }
+};
+
+#endif
@@ -3,19 +3,63 @@
 
 #include <ostream>
 #include <algorithm>
+#include <cmath>
 #include <iterator>
 #include <cstddef>
+#include <cstdint>
+#include <istream>
+#include <limits>
+#include <memory>
+#include <new>
+#include <random>
+#include <stdexcept>
+#include <type_traits>
+#include <utility>
+#include <vector>
 #include "element_not_found_exception.h"
+#include "multiset_io.h"
+#include "count_traits.h"
+#include "multiset_stats.h"
+#include "multiset_cache.h"
+#include "alias_sampler.h"
 /**
  * @brief Classe templata che implementa un MultiSet
  *
  * @tparam T tipo del dato
  * @tparam Comp funtore di comparazione
  * @tparam Eq funtore di equivalenza
+ * @tparam CountT tipo intero senza segno delle occorrenze e del totale, oppure
+ *  saturating_count<U> / checked_count<U> per fermarsi al massimo o lanciare una eccezione
+ * @tparam N numero di nodi memorizzati dentro il multiset, senza allocazioni (al massimo 64)
+ * @tparam Stats politica di statistiche: no_stats (nessun costo) o counting_stats, letta con stats()
+ * @tparam Cache politica di cache delle ricerche: no_cache (nessun costo) o mru_cache, letta con cache()
  */
-template <typename T, typename Comp, typename Eq>
+template <typename T, typename Comp, typename Eq, typename CountT = unsigned int, std::size_t N = 0,
+          typename Stats = no_stats, typename Cache = no_cache>
 class multiset
 {
+    template <typename T2, typename Comp2, typename Eq2, typename CountT2, std::size_t N2, typename Stats2, typename Cache2>
+    friend class multiset;
+
+public:
+    /**
+     * @brief Tipo delle occorrenze e del numero totale di elementi
+     */
+    typedef typename count_traits<CountT>::type count_type;
+
+    /**
+     * @brief Differenza tra due multiset: coppie (valore, variazione delle occorrenze)
+     * nell'ordine di Comp, prodotta da diff e take_changes e applicata da apply
+     */
+    typedef std::vector<std::pair<T, std::int64_t> > delta_type;
+
+    /**
+     * @brief Lapidi sempre tollerate con le lapidi attive, anche quando size() e' piccolo o zero
+     */
+    static const std::size_t min_tombstones = 8;
+
+    class const_iterator;
+
 private:
     /**
      * @brief Nodo della linked list
@@ -24,7 +68,7 @@ private:
     struct node
     {
         T _value;
-        unsigned int _occurrences;
+        count_type _occurrences;
         node *_next;
         // Costruttore di default
         node() : _occurrences(0), _next(nullptr) {}
@@ -33,14 +77,14 @@ private:
          * Inizializza un nuovo nodo con il valore passato come parametro senza un nodo successivo
          * @param value Valore da assegnare al nodo
          */
-        node(T value) : _occurrences(1), _value(value), _next(nullptr) {}
+        node(T value) : _occurrences(1), _value(std::move(value)), _next(nullptr) {}
         /** 
          * @brief Costruttore di un nuovo oggetto node
          * Inizializza un nuovo nodo con il valore passato come parametro e il nodo successivo
          * @param value Valore da assegnare al nodo
          * @param next Nodo successivo
          */
-        node(T value, node *next) : _occurrences(1), _value(value), _next(next) {}
+        node(T value, node *next) : _occurrences(1), _value(std::move(value)), _next(next) {}
         /** 
          * @brief Copy constructor
          * Inizializza un nuovo nodo con un nodo passato come parametro
@@ -90,338 +134,2217 @@ private:
         ~node() {
             _next = nullptr;
         }
-    };
+    };
+
+    static_assert(N <= 64, "multiset inline capacity is limited to 64 nodes");
+
+    /**
+     * @brief Spazio per i primi N nodi, interno al multiset
+     * Una maschera di bit tiene traccia degli slot occupati
+     */
+    template <std::size_t Cap, typename Dummy = void>
+    struct inline_storage
+    {
+        alignas(node) unsigned char _bytes[Cap * sizeof(node)];
+        std::uint64_t _used;
+
+        inline_storage() : _used(0) {}
+
+        node *slot(std::size_t i)
+        {
+            return reinterpret_cast<node *>(_bytes) + i;
+        }
+
+        bool owns(const node *n) const
+        {
+            const node *first = reinterpret_cast<const node *>(_bytes);
+            return !std::less<const node *>()(n, first) && std::less<const node *>()(n, first + Cap);
+        }
+
+        // Ritorna uno slot libero, nullptr se sono tutti occupati
+        node *acquire()
+        {
+            std::uint64_t full = Cap == 64 ? ~static_cast<std::uint64_t>(0) : (static_cast<std::uint64_t>(1) << Cap) - 1;
+            if (_used == full)
+            {
+                return nullptr;
+            }
+            std::size_t i = __builtin_ctzll(~_used);
+            _used |= static_cast<std::uint64_t>(1) << i;
+            return slot(i);
+        }
+
+        void release(node *n)
+        {
+            _used &= ~(static_cast<std::uint64_t>(1) << (n - slot(0)));
+        }
+    };
+
+    template <typename Dummy>
+    struct inline_storage<0, Dummy>
+    {
+        node *slot(std::size_t) { return nullptr; }
+        bool owns(const node *) const { return false; }
+        node *acquire() { return nullptr; }
+        void release(node *) {}
+    };
+
+    /**
+     * @brief Blocco contiguo di nodi creato da compact
+     * Gli slot liberati non vengono riusati: il blocco viene liberato quando muore l'ultimo nodo
+     */
+    struct slab
+    {
+        node *_nodes;
+        std::size_t _capacity;
+        std::size_t _live;
+
+        bool owns(const node *n) const
+        {
+            return !std::less<const node *>()(n, _nodes) && std::less<const node *>()(n, _nodes + _capacity);
+        }
+    };
+
+    node *_head;
+    count_type _size;
+    Comp _cmp;
+    Eq _eq;
+    inline_storage<N> _inline;
+    slab *_slab;
+    node *_finger; // ultimo nodo inserito o incrementato da add, nullptr se non valido
+    std::size_t _tombstones;   // nodi con zero occorrenze lasciati da remove
+    double _tombstone_ratio;   // 0: remove libera subito i nodi (vedi set_tombstone_ratio)
+    bool _tracking;            // registra le variazioni in _journal (vedi track_changes)
+    delta_type _journal;
+    [[no_unique_address]] mutable Stats _stats;
+    // nodi cercati di recente, invalidati da destroy_node e quando i nodi passano a un altro multiset
+    [[no_unique_address]] mutable typename Cache::template table<T, node> _cache;
+
+    // Chiamate ai funtori, contate dalla politica di statistiche
+    bool compare(const T &a, const T &b) const
+    {
+        _stats.on_compare();
+        return _cmp(a, b);
+    }
+
+    bool equal(const T &a, const T &b) const
+    {
+        _stats.on_equal();
+        return _eq(a, b);
+    }
+
+    // Nodo di value se e' nella cache, nullptr altrimenti
+    node *cached(const T &value) const
+    {
+        node *n = _cache.find(value);
+        if (n != nullptr && equal(n->_value, value))
+        {
+            _cache.hit();
+            return n;
+        }
+        _cache.miss();
+        return nullptr;
+    }
+
+    // Registra una variazione delle occorrenze di value se il tracciamento e' attivo
+    void record(const T &value, std::int64_t delta)
+    {
+        if (_tracking && delta != 0)
+        {
+            _journal.push_back(std::make_pair(value, delta));
+        }
+    }
+
+    /**
+     * @brief Crea un nodo
+     * Usa uno slot interno se disponibile, altrimenti alloca il nodo sullo heap
+     * @param value Valore del nodo
+     * @param next Nodo successivo
+     * @return node* Il nodo creato, con una occorrenza
+     */
+    template <typename V>
+    node *create_node(V &&value, node *next)
+    {
+        node *n = _inline.acquire();
+        if (n == nullptr)
+        {
+            n = new node(std::forward<V>(value), next);
+            _stats.on_allocate();
+            return n;
+        }
+        try
+        {
+            return new (n) node(std::forward<V>(value), next);
+        }
+        catch (...)
+        {
+            _inline.release(n);
+            throw;
+        }
+    }
+
+    /**
+     * @brief Distrugge un nodo creato con create_node
+     * @param n Nodo da distruggere
+     */
+    void destroy_node(node *n)
+    {
+        if (n == _finger)
+        {
+            _finger = nullptr;
+        }
+        _cache.forget(n);
+        if (_inline.owns(n))
+        {
+            n->~node();
+            _inline.release(n);
+        }
+        else if (_slab != nullptr && _slab->owns(n))
+        {
+            n->~node();
+            if (--_slab->_live == 0)
+            {
+                free_slab();
+            }
+        }
+        else
+        {
+            delete n;
+            _stats.on_deallocate();
+        }
+    }
+
+    void free_slab()
+    {
+        std::allocator<node>().deallocate(_slab->_nodes, _slab->_capacity);
+        delete _slab;
+        _slab = nullptr;
+        _stats.on_deallocate();
+    }
+
+    /**
+     * @brief Byte occupati da una allocazione di bytes byte con malloc
+     * Stima per allocatori come quello della glibc: 8 byte di intestazione e blocchi multipli di 16, almeno 32
+     */
+    static std::size_t allocated_bytes(std::size_t bytes)
+    {
+        std::size_t chunk = (bytes + 8 + 15) & ~static_cast<std::size_t>(15);
+        return chunk < 32 ? 32 : chunk;
+    }
+
+    /**
+     * @brief Prende il contenuto di un altro multiset
+     * Il multiset deve essere vuoto. I nodi sullo heap vengono ricollegati, quelli interni
+     * all'altro multiset vengono spostati nei nodi di questo. Alla fine other e' vuoto.
+     * @param other Multiset da svuotare
+     */
+    void take(multiset &other)
+    {
+        // i nodi del blocco contiguo passano insieme al blocco
+        _slab = other._slab;
+        other._slab = nullptr;
+        _finger = nullptr;
+        other._finger = nullptr;
+        _cache.clear();
+        other._cache.clear();
+        node *tail = nullptr;
+        node *curr = other._head;
+        while (curr != nullptr)
+        {
+            node *next = curr->_next;
+            node *n = curr;
+            if (other._inline.owns(curr))
+            {
+                n = create_node(std::move(curr->_value), nullptr);
+                n->_occurrences = curr->_occurrences;
+                other.destroy_node(curr);
+            }
+            n->_next = nullptr;
+            if (tail == nullptr)
+            {
+                _head = n;
+            }
+            else
+            {
+                tail->_next = n;
+            }
+            tail = n;
+            curr = next;
+        }
+        _size = other._size;
+        _tombstones = other._tombstones;
+        other._head = nullptr;
+        other._size = 0;
+        other._tombstones = 0;
+        for (node *n = _head; n != nullptr && (_tracking || other._tracking); n = n->_next)
+        {
+            other.record(n->_value, -static_cast<std::int64_t>(n->_occurrences));
+            record(n->_value, static_cast<std::int64_t>(n->_occurrences));
+        }
+    }
+
+    /**
+     * @brief Inserisce un valore con un numero di occorrenze
+     * Cerca la posizione del valore dall'inizio della lista, non aggiorna _size
+     * @param value Valore da inserire
+     * @param occurrences Occorrenze da aggiungere
+     */
+    void insert_occurrences(const T &value, count_type occurrences)
+    {
+        node *curr = _head;
+        node *prev = nullptr;
+        _stats.on_lookup();
+        while (curr != nullptr && !compare(curr->_value, value))
+        {
+            if (equal(curr->_value, value))
+            {
+                curr->_occurrences += occurrences;
+                return;
+            }
+            prev = curr;
+            curr = curr->_next;
+            _stats.on_hop();
+        }
+        if (curr != nullptr && equal(curr->_value, value))
+        {
+            curr->_occurrences += occurrences;
+            return;
+        }
+        node *n = create_node(value, curr);
+        n->_occurrences = occurrences;
+        if (prev == nullptr)
+        {
+            _head = n;
+        }
+        else
+        {
+            prev->_next = n;
+        }
+    }
+
+    /**
+     * @brief Posizione (da 1) dell'elemento che corrisponde al quantile q
+     * @throw std::invalid_argument se q non e' in [0, 1]
+     * @throw element_not_found_exception se il multiset e' vuoto
+     */
+    count_type quantile_rank(double q) const
+    {
+        if (!(q >= 0 && q <= 1))
+        {
+            throw std::invalid_argument("Error, quantile must be in [0, 1]");
+        }
+        if (_size == 0)
+        {
+            throw element_not_found_exception("Error, quantile of an empty multiset");
+        }
+        double rank = std::ceil(q * static_cast<double>(_size));
+        if (rank < 1)
+        {
+            return 1;
+        }
+        if (rank >= static_cast<double>(_size))
+        {
+            return _size;
+        }
+        return static_cast<count_type>(rank);
+    }
+
+    /**
+     * @brief Accoda un nodo letto da un multiset serializzato
+     * Controlla che il valore rispetti l'ordine di Comp rispetto all'ultimo nodo
+     * @param tail Ultimo nodo della catena (nullptr se vuota)
+     * @param value Valore del nodo
+     * @param occurrences Occorrenze del valore
+     * @return node* Il nuovo ultimo nodo
+     */
+    node *append_loaded(node *tail, const T &value, std::uint64_t occurrences)
+    {
+        if (occurrences == 0 || occurrences > std::numeric_limits<count_type>::max())
+        {
+            throw invalid_format_exception("Error, invalid occurrences in serialized multiset");
+        }
+        if (tail != nullptr && !compare(value, tail->_value))
+        {
+            throw invalid_format_exception("Error, serialized multiset is not sorted");
+        }
+
+        node *n = create_node(value, nullptr);
+        n->_occurrences = static_cast<count_type>(occurrences);
+        if (tail == nullptr)
+        {
+            _head = n;
+        }
+        else
+        {
+            tail->_next = n;
+        }
+        return n;
+    }
+
+    /**
+     * @brief Controlla se value va dopo il nodo n (o e' uguale al suo valore)
+     * In questo caso la ricerca di value puo' partire da n invece che dalla testa
+     */
+    bool follows(const node *n, const T &value) const
+    {
+        return n != nullptr && !compare(n->_value, value);
+    }
+
+    /**
+     * @brief Aggiunge un valore cercandone la posizione a partire da start
+     * start e' nullptr (ricerca dalla testa) o un nodo per cui follows(start, value)
+     * @return node* Il nodo del valore, che diventa il nuovo finger; nullptr se il valore e' nuovo
+     * ma il multiset ha gia' il massimo di elementi consentito da CountT
+     */
+    node *add_from(node *start, const T &value)
+    {
+        node *curr = cached(value);
+        _stats.on_lookup();
+        if (curr == nullptr)
+        {
+            curr = start == nullptr ? _head : start;
+        }
+        // il valore non va mai prima di start, quindi prev serve solo dopo il primo passo
+        node *prev = nullptr;
+        while (curr != nullptr)
+        {
+            if (equal(curr->_value, value))
+            {
+                count_type d = count_traits<CountT>::room(curr->_occurrences, 1);
+                d = count_traits<CountT>::room(_size, d);
+                if (curr->_occurrences == 0 && d > 0)
+                {
+                    --_tombstones;
+                }
+                curr->_occurrences += d;
+                _size += d;
+                _finger = curr;
+                _cache.store(value, curr);
+                record(value, d);
+                return curr;
+            }
+            if (compare(curr->_value, value))
+            {
+                break;
+            }
+            prev = curr;
+            curr = curr->_next;
+            _stats.on_hop();
+        }
+
+        // il nodo viene creato solo se il valore non e' gia' presente e c'e' spazio per contarlo
+        count_type d = count_traits<CountT>::room(_size, 1);
+        if (d == 0)
+        {
+            return nullptr;
+        }
+        node *tmp = create_node(value, curr);
+        if (prev == nullptr)
+        {
+            _head = tmp;
+        }
+        else
+        {
+            prev->_next = tmp;
+        }
+        _size += d;
+        _finger = tmp;
+        _cache.store(value, tmp);
+        record(value, d);
+        return tmp;
+    }
+
+    /**
+     * @brief Nodo che precede quello puntato da pos (nullptr se e' la testa)
+     * Se pos e' arrivato al nodo scorrendo la lista il precedente e' gia' noto e il costo e' O(1),
+     * altrimenti la lista viene scorsa dalla testa
+     */
+    node *prev_of(const const_iterator &pos) const
+    {
+        if (pos._prev != nullptr && pos._prev->_next == pos.ptr)
+        {
+            return pos._prev;
+        }
+        node *prev = nullptr;
+        for (node *curr = _head; curr != pos.ptr; curr = curr->_next)
+        {
+            prev = curr;
+            _stats.on_hop();
+        }
+        return prev;
+    }
+
+    /**
+     * @brief Stacca e distrugge il nodo curr, preceduto da prev
+     * @return node* Nodo successivo a curr
+     */
+    node *unlink(node *prev, node *curr)
+    {
+        record(curr->_value, -static_cast<std::int64_t>(curr->_occurrences));
+        node *next = curr->_next;
+        if (prev == nullptr)
+        {
+            _head = next;
+        }
+        else
+        {
+            prev->_next = next;
+        }
+        if (curr->_occurrences == 0)
+        {
+            --_tombstones;
+        }
+        _size -= curr->_occurrences;
+        destroy_node(curr);
+        return next;
+    }
+
+    // Le lapidi sono troppe se superano sia min_tombstones sia _tombstone_ratio * size()
+    bool too_many_tombstones() const
+    {
+        return _tombstones > min_tombstones && _tombstones > _tombstone_ratio * _size;
+    }
+
+    /**
+     * @brief Conta una nuova lapide e libera tutte le lapidi se sono troppe
+     */
+    void bury()
+    {
+        ++_tombstones;
+        if (too_many_tombstones())
+        {
+            purge();
+        }
+    }
+
+    /**
+     * @brief Libera tutte le lapidi con un solo passaggio
+     */
+    void purge()
+    {
+        node *prev = nullptr;
+        node *curr = _head;
+        while (_tombstones > 0 && curr != nullptr)
+        {
+            if (curr->_occurrences == 0)
+            {
+                curr = unlink(prev, curr);
+            }
+            else
+            {
+                prev = curr;
+                curr = curr->_next;
+            }
+        }
+    }
+
+    /**
+     * @brief Confronto tra multiset con lo stesso ordinamento
+     * Le due liste sono ordinate allo stesso modo: basta confrontarle nodo per nodo
+     */
+    template <typename T2, typename Comp2, typename Eq2, typename CountT2, std::size_t N2, typename Stats2, typename Cache2>
+    bool equals(const multiset<T2, Comp2, Eq2, CountT2, N2, Stats2, Cache2> &other, std::true_type) const
+    {
+        if (_size != other._size)
+        {
+            return false;
+        }
+        const node *a = _head;
+        const typename multiset<T2, Comp2, Eq2, CountT2, N2, Stats2, Cache2>::node *b = other._head;
+        while (true)
+        {
+            while (a != nullptr && a->_occurrences == 0)
+            {
+                a = a->_next;
+            }
+            while (b != nullptr && b->_occurrences == 0)
+            {
+                b = b->_next;
+            }
+            if (a == nullptr || b == nullptr)
+            {
+                return a == nullptr && b == nullptr;
+            }
+            if (a->_value != b->_value || a->_occurrences != b->_occurrences)
+            {
+                return false;
+            }
+            a = a->_next;
+            b = b->_next;
+        }
+    }
+
+    /**
+     * @brief Confronto tra multiset con ordinamenti diversi
+     * Riordina gli elementi di other secondo Comp in un multiset temporaneo
+     */
+    template <typename T2, typename Comp2, typename Eq2, typename CountT2, std::size_t N2, typename Stats2, typename Cache2>
+    bool equals(const multiset<T2, Comp2, Eq2, CountT2, N2, Stats2, Cache2> &other, std::false_type) const
+    {
+        multiset tmp(other.begin(), other.end());
+        const_iterator it = begin();
+        const_iterator it2 = tmp.begin();
+        if (size() != tmp.size())
+        {
+            return false;
+        }
+        while (it != end() && it2 != tmp.end())
+        {
+            if (*it != *it2)
+            {
+                return false;
+            }
+            ++it;
+            ++it2;
+        }
+        return it == end() && it2 == tmp.end();
+    }
+
+public:
+    /**
+     * @brief Costruttore di default
+     * Inizializza un nuovo multiset vuoto
+     */
+    multiset() : _head(nullptr), _size(0), _slab(nullptr), _finger(nullptr), _tombstones(0), _tombstone_ratio(0), _tracking(false) {}
+
+    /**
+     * @brief Costruttore di copia
+     * Inizializza un nuovo multiset con un multiset passato come parametro
+     * @param other Multiset da copiare
+     */
+    multiset(const multiset &other)
+        : _head(nullptr), _size(0), _slab(nullptr), _finger(nullptr), _tombstones(0), _tombstone_ratio(other._tombstone_ratio),
+          _tracking(false)
+    {
+        node *tail = nullptr;
+
+        try
+        {
+            for (node *curr = other._head; curr != nullptr; curr = curr->_next)
+            {
+                if (curr->_occurrences == 0)
+                {
+                    continue;
+                }
+                node *n = create_node(curr->_value, nullptr);
+                n->_occurrences = curr->_occurrences;
+                if (tail == nullptr)
+                {
+                    _head = n;
+                }
+                else
+                {
+                    tail->_next = n;
+                }
+                tail = n;
+            }
+            _size = other._size;
+        }
+        catch (...)
+        {
+            clear();
+            throw;
+        }
+    }
+
+    /**
+     * @brief Move constructor
+     * Prende i nodi di un altro multiset, che rimane vuoto
+     * @param other Multiset da spostare
+     */
+    multiset(multiset &&other)
+        : _head(nullptr), _size(0), _slab(nullptr), _finger(nullptr), _tombstones(0), _tombstone_ratio(other._tombstone_ratio),
+          _tracking(false)
+    {
+        take(other);
+    }
+
+    /**
+     * @brief Costruttore di copia tramite iteratore
+     * Inizializza un nuovo multiset con due iteratori passati come parametro
+     * @param begin Iteratore all'inizio del range
+     * @param end Iteratore alla fine del range
+     */
+    template <typename Iter>
+    multiset(Iter b, Iter e)
+        : _head(nullptr), _size(0), _slab(nullptr), _finger(nullptr), _tombstones(0), _tombstone_ratio(0), _tracking(false)
+    {
+        try
+        {
+            for (; b != e; ++b)
+            {
+                add(static_cast<T>(*b));
+            }
+        }
+        catch (...)
+        {
+            clear();
+            throw;
+        }
+    }
+
+    /**
+     * @brief Operatore di assignement
+     * Assegna un multiset ad un altro multiset
+     * @param other Multiset da copiare
+     * @return multiset& Multiset copiato
+     */
+    multiset &operator=(const multiset &other)
+    {
+        if (this != &other)
+        {
+            multiset tmp(other);
+            clear();
+            take(tmp);
+            _tombstone_ratio = other._tombstone_ratio;
+        }
+        return *this;
+    }
+
+    /**
+     * @brief Operatore di move assignement
+     * Prende i nodi di un altro multiset, che rimane vuoto
+     * @param other Multiset da spostare
+     * @return multiset& Questo multiset
+     */
+    multiset &operator=(multiset &&other)
+    {
+        if (this != &other)
+        {
+            clear();
+            take(other);
+            _tombstone_ratio = other._tombstone_ratio;
+        }
+        return *this;
+    }
+
+    /**
+     * @brief Operatore di uguaglianza
+     * Controlla se due multiset sono uguali confrontando tutti i valori dei nodi e il numero di occorrenze di ogni nodo
+     * E' templata per permettere la comparazione tra multiset di tipi diversi.
+     * Con lo stesso tipo e lo stesso ordinamento le liste si confrontano nodo per nodo in O(n), senza allocazioni.
+     * @param other Multiset da confrontare
+     * @return true 
+     * @return false 
+     */
+    template <typename T2, typename Comp2, typename Eq2, typename CountT2, std::size_t N2, typename Stats2, typename Cache2>
+    bool operator==(const multiset<T2, Comp2, Eq2, CountT2, N2, Stats2, Cache2> &other) const
+    {
+        return equals(other, std::integral_constant<bool, std::is_same<T, T2>::value && std::is_same<Comp, Comp2>::value>());
+    }
+
+    /**
+     * @brief Operatore di disuguaglianza
+     * Controlla se due multiset sono diversi confrontando tutti i valori dei nodi e il numero di occorrenze di ogni nodo
+     * E' templata per permettere la comparazione tra multiset di tipi diversi
+     * @param other Multiset da confrontare
+     * @return true 
+     * @return false 
+     */
+    template <typename T2, typename Comp2, typename Eq2, typename CountT2, std::size_t N2, typename Stats2, typename Cache2>
+    bool operator!=(const multiset<T2, Comp2, Eq2, CountT2, N2, Stats2, Cache2> &other) const
+    {
+        return !(*this == other);
+    }
+
+    /**
+     * @brief Size
+     * Ritorna il numero di nodi presenti nel multiset
+     * 
+     * @return count_type 
+     */
+    count_type size() const { return _size; }
+
+    /**
+     * @brief Get the Occurrences
+     * Ritorna il numero di occorrenze di un valore nel multiset
+     * @param value 
+     * @return count_type 
+     */
+    count_type getOccurrences(const T &value) const
+    {
+        node *iter = cached(value);
+        _stats.on_lookup();
+        if (iter != nullptr)
+        {
+            return iter->_occurrences;
+        }
+        iter = _head;
+        while (iter != nullptr)
+        {
+            if (equal(iter->_value, value))
+            {
+                _cache.store(value, iter);
+                return iter->_occurrences;
+            }
+            iter = iter->_next;
+            _stats.on_hop();
+        }
+        return 0;
+    }
+
+    /**
+     * @brief Add
+     * Aggiunge un valore al multiset.
+     * Se il valore segue l'ultimo nodo inserito la ricerca riparte da quel nodo,
+     * quindi i valori che arrivano gia' nell'ordine di Comp si inseriscono in O(1) ammortizzato.
+     * @param value 
+     */
+    void add(const T &value)
+    {
+        add_from(follows(_finger, value) ? _finger : nullptr, value);
+    }
+
+    /**
+     * @brief Add con suggerimento
+     * Aggiunge un valore cercandone la posizione a partire da hint, se hint non segue il valore;
+     * altrimenti si comporta come add(value)
+     * @param hint Iteratore a un elemento di questo multiset, o end()
+     * @param value
+     * @return const_iterator Iteratore all'elemento inserito, end() se un valore nuovo non ha trovato spazio
+     */
+    const_iterator add(const_iterator hint, const T &value)
+    {
+        node *start = follows(hint.ptr, value) ? hint.ptr : (follows(_finger, value) ? _finger : nullptr);
+        return const_iterator(add_from(start, value));
+    }
+
+    /**
+     * @brief Emplace Hint
+     * Costruisce un valore dagli argomenti e lo aggiunge come add(hint, value)
+     * @param hint Iteratore a un elemento di questo multiset, o end()
+     * @param args Argomenti del costruttore di T
+     * @return const_iterator Iteratore all'elemento inserito
+     */
+    template <typename... Args>
+    const_iterator emplace_hint(const_iterator hint, Args &&...args)
+    {
+        return add(hint, T(std::forward<Args>(args)...));
+    }
+
+    /**
+     * @brief Remove
+     * Rimuove un valore dal multiset.
+     * Con le lapidi attive (vedi set_tombstone_ratio) il nodo dell'ultima occorrenza resta nella lista.
+     * @param value 
+     */
+    void remove(const T &value)
+    {
+        node *curr = cached(value);
+        node *prev = _head;
+        _stats.on_lookup();
+        // dalla cache manca il nodo precedente: basta solo se il nodo resta nella lista
+        if (curr != nullptr && (curr->_occurrences > 1 || (curr->_occurrences == 1 && _tombstone_ratio > 0)))
+        {
+            curr->_occurrences--;
+            _size--;
+            record(value, -1);
+            if (curr->_occurrences == 0)
+            {
+                bury();
+            }
+            return;
+        }
+        curr = _head;
+        while (curr != nullptr)
+        {
+            if (equal(curr->_value, value))
+            {
+                if (curr->_occurrences > 1 || (curr->_occurrences == 1 && _tombstone_ratio > 0))
+                {
+                    curr->_occurrences--;
+                    _size--;
+                    record(value, -1);
+                    _cache.store(value, curr);
+                    if (curr->_occurrences == 0)
+                    {
+                        bury();
+                    }
+                    return;
+                }
+                else if (curr->_occurrences == 0)
+                {
+                    break;
+                }
+                else
+                {
+                    if (curr == _head)
+                    {
+                        _head = curr->_next;
+                        destroy_node(curr);
+                        _size--;
+                        record(value, -1);
+                        return;
+                    }
+                    else
+                    {
+                        prev->_next = curr->_next;
+                        destroy_node(curr);
+                        _size--;
+                        record(value, -1);
+                        return;
+                    }
+                }
+            }
+            prev = curr;
+            curr = curr->_next;
+            _stats.on_hop();
+        }
+        // se arrivati a questo punto non è stato trovato l'elemento lancio una eccezione
+        _stats.on_not_found();
+        throw element_not_found_exception("Error, element not found in multiset");
+    }
+
+    /**
+     * @brief Erase
+     * Rimuove l'occorrenza puntata da pos senza cercarne il valore.
+     * Se pos e' stato ottenuto scorrendo la lista (begin, ++, o un altro erase) costa O(1),
+     * altrimenti il nodo precedente viene cercato dalla testa.
+     * Invalida gli iteratori al nodo rimosso e al nodo che lo segue; l'iteratore ritornato resta valido.
+     * @param pos Iteratore a un elemento di questo multiset
+     * @return const_iterator Iteratore all'elemento successivo a quello rimosso
+     * @throw element_not_found_exception se pos e' end()
+     */
+    const_iterator erase(const_iterator pos)
+    {
+        if (pos.ptr == nullptr)
+        {
+            throw element_not_found_exception("Error, cannot erase the end of multiset");
+        }
+        node *prev = prev_of(pos);
+        if (pos.ptr->_occurrences > 1)
+        {
+            pos.ptr->_occurrences--;
+            _size--;
+            record(pos.ptr->_value, -1);
+            if (pos._counter <= pos.ptr->_occurrences)
+            {
+                return const_iterator(pos.ptr, prev, pos._counter);
+            }
+            return const_iterator(pos.ptr->_next, pos.ptr, 1);
+        }
+        return const_iterator(unlink(prev, pos.ptr), prev, 1);
+    }
+
+    /**
+     * @brief Erase All
+     * Rimuove tutte le occorrenze dell'elemento puntato da pos, con lo stesso costo di erase(pos)
+     * @param pos Iteratore a un elemento di questo multiset
+     * @return const_iterator Iteratore al primo elemento con un valore diverso
+     * @throw element_not_found_exception se pos e' end()
+     */
+    const_iterator erase_all(const_iterator pos)
+    {
+        if (pos.ptr == nullptr)
+        {
+            throw element_not_found_exception("Error, cannot erase the end of multiset");
+        }
+        node *prev = prev_of(pos);
+        return const_iterator(unlink(prev, pos.ptr), prev, 1);
+    }
+
+    /**
+     * @brief Erase
+     * Rimuove gli elementi nell'intervallo [first, last) con un solo passaggio:
+     * O(k) nei valori distinti rimossi, piu' la ricerca del precedente di first se non e' noto
+     * @param first Iteratore al primo elemento da rimuovere
+     * @param last Iteratore successivo all'ultimo elemento da rimuovere, o end()
+     * @return const_iterator Iteratore all'elemento che era puntato da last
+     */
+    const_iterator erase(const_iterator first, const_iterator last)
+    {
+        if (first.ptr == nullptr)
+        {
+            return end();
+        }
+        node *prev = prev_of(first);
+        node *curr = first.ptr;
+        count_type counter = first._counter;
+        while (curr != last.ptr)
+        {
+            if (counter == 1)
+            {
+                curr = unlink(prev, curr);
+            }
+            else
+            {
+                // restano le occorrenze che precedono first
+                count_type removed = curr->_occurrences - (counter - 1);
+                _size -= removed;
+                curr->_occurrences = counter - 1;
+                record(curr->_value, -static_cast<std::int64_t>(removed));
+                prev = curr;
+                curr = curr->_next;
+                counter = 1;
+            }
+        }
+        if (curr != nullptr && last._counter > counter)
+        {
+            count_type removed = last._counter - counter;
+            curr->_occurrences -= removed;
+            _size -= removed;
+            record(curr->_value, -static_cast<std::int64_t>(removed));
+        }
+        return const_iterator(curr, prev, counter);
+    }
+
+    /**
+     * @brief Erase If
+     * Rimuove tutte le occorrenze dei valori che soddisfano pred, con un solo passaggio: O(n)
+     * @param pred Predicato sul valore
+     * @return count_type Numero di elementi rimossi
+     */
+    template <typename Pred>
+    count_type erase_if(Pred pred)
+    {
+        count_type removed = 0;
+        node *prev = nullptr;
+        node *curr = _head;
+        while (curr != nullptr)
+        {
+            if (pred(static_cast<const T &>(curr->_value)))
+            {
+                removed += curr->_occurrences;
+                curr = unlink(prev, curr);
+            }
+            else
+            {
+                prev = curr;
+                curr = curr->_next;
+            }
+        }
+        return removed;
+    }
+
+    /**
+     * @brief Merge
+     * Aggiunge a questo multiset tutte le occorrenze di un altro multiset dello stesso tipo.
+     * Le due liste sono ordinate allo stesso modo, quindi basta un solo passaggio: O(n + m)
+     * @param other Multiset da aggiungere
+     */
+    void merge(const multiset &other)
+    {
+        purge();
+        node *prev = nullptr;
+        node *curr = _head;
+        for (node *o = other._head; o != nullptr; o = o->_next)
+        {
+            while (curr != nullptr && !equal(curr->_value, o->_value) && !compare(curr->_value, o->_value))
+            {
+                prev = curr;
+                curr = curr->_next;
+            }
+            count_type d = count_traits<CountT>::room(_size, o->_occurrences);
+            if (curr != nullptr && equal(curr->_value, o->_value))
+            {
+                d = count_traits<CountT>::room(curr->_occurrences, d);
+                curr->_occurrences += d;
+            }
+            else if (d > 0)
+            {
+                node *n = create_node(o->_value, curr);
+                n->_occurrences = d;
+                if (prev == nullptr)
+                {
+                    _head = n;
+                }
+                else
+                {
+                    prev->_next = n;
+                }
+                curr = n;
+            }
+            _size += d;
+            record(o->_value, d);
+        }
+    }
+
+    /**
+     * @brief Merge
+     * Sposta in questo multiset tutti i nodi di other, che rimane vuoto (vedi splice)
+     * @param other Multiset da svuotare
+     */
+    void merge(multiset &&other)
+    {
+        splice(other);
+    }
+
+    /**
+     * @brief Splice
+     * Sposta in questo multiset tutti i nodi di other con un solo passaggio sulle due liste, O(n + m).
+     * I nodi di other sullo heap vengono ricollegati senza allocazioni; quelli di valori gia'
+     * presenti vengono sommati e liberati. Solo i nodi interni o nel blocco contiguo di other
+     * devono essere copiati. Alla fine other e' vuoto.
+     * @param other Multiset da svuotare
+     */
+    void splice(multiset &other)
+    {
+        if (&other == this)
+        {
+            return;
+        }
+        purge();
+        other.purge();
+        other._finger = nullptr;
+        other._cache.clear();
+        node *prev = nullptr;
+        node *curr = _head;
+        while (other._head != nullptr)
+        {
+            node *o = other._head;
+            other.record(o->_value, -static_cast<std::int64_t>(o->_occurrences));
+            while (curr != nullptr && !equal(curr->_value, o->_value) && !compare(curr->_value, o->_value))
+            {
+                prev = curr;
+                curr = curr->_next;
+            }
+            count_type d = count_traits<CountT>::room(_size, o->_occurrences);
+            if (curr != nullptr && equal(curr->_value, o->_value))
+            {
+                d = count_traits<CountT>::room(curr->_occurrences, d);
+                curr->_occurrences += d;
+                other._head = o->_next;
+                other._size -= o->_occurrences;
+                other.destroy_node(o);
+            }
+            else if (d == 0)
+            {
+                // contatore saturo: le occorrenze di o vanno perse come in add
+                other._head = o->_next;
+                other._size -= o->_occurrences;
+                other.destroy_node(o);
+            }
+            else
+            {
+                node *n = o;
+                if (other._inline.owns(o) || (other._slab != nullptr && other._slab->owns(o)))
+                {
+                    n = create_node(std::move_if_noexcept(o->_value), curr);
+                }
+                other._head = o->_next;
+                other._size -= o->_occurrences;
+                if (n != o)
+                {
+                    other.destroy_node(o);
+                }
+                n->_occurrences = d;
+                n->_next = curr;
+                if (prev == nullptr)
+                {
+                    _head = n;
+                }
+                else
+                {
+                    prev->_next = n;
+                }
+                curr = n;
+            }
+            _size += d;
+            if (d > 0)
+            {
+                record(curr->_value, d);
+            }
+        }
+    }
+
+    /**
+     * @brief Node Handle
+     * Possiede un nodo estratto da un multiset, con il suo valore e le sue occorrenze.
+     * Puo' essere reinserito con insert nello stesso multiset o in un altro dello stesso tipo
+     * senza allocazioni. Se non viene reinserito il nodo viene distrutto con il handle.
+     */
+    class node_handle
+    {
+    public:
+        node_handle() : _node(nullptr) {}
+
+        node_handle(node_handle &&other) : _node(other._node)
+        {
+            other._node = nullptr;
+        }
+
+        node_handle &operator=(node_handle &&other)
+        {
+            if (this != &other)
+            {
+                delete _node;
+                _node = other._node;
+                other._node = nullptr;
+            }
+            return *this;
+        }
+
+        node_handle(const node_handle &other) = delete;
+        node_handle &operator=(const node_handle &other) = delete;
+
+        ~node_handle()
+        {
+            delete _node;
+        }
+
+        // Controlla se il handle e' vuoto
+        bool empty() const { return _node == nullptr; }
+        explicit operator bool() const { return _node != nullptr; }
+
+        // Valore del nodo, modificabile prima di reinserirlo
+        T &value() const { return _node->_value; }
+
+        // Occorrenze del valore
+        count_type occurrences() const { return _node->_occurrences; }
+
+    private:
+        friend class multiset;
+        explicit node_handle(node *n) : _node(n) {}
+        node *_node;
+    };
+
+    /**
+     * @brief Extract
+     * Toglie dal multiset il nodo di un valore, con tutte le sue occorrenze.
+     * Un nodo interno o nel blocco contiguo viene copiato in un nodo sullo heap.
+     * @param value
+     * @return node_handle Il nodo estratto, vuoto se il valore non e' presente
+     */
+    node_handle extract(const T &value)
+    {
+        node *prev = nullptr;
+        node *curr = _head;
+        _stats.on_lookup();
+        while (curr != nullptr && !equal(curr->_value, value))
+        {
+            prev = curr;
+            curr = curr->_next;
+            _stats.on_hop();
+        }
+        if (curr == nullptr || curr->_occurrences == 0)
+        {
+            return node_handle();
+        }
+
+        node *n = curr;
+        if (_inline.owns(curr) || (_slab != nullptr && _slab->owns(curr)))
+        {
+            n = new node(std::move_if_noexcept(curr->_value));
+            _stats.on_allocate();
+            n->_occurrences = curr->_occurrences;
+        }
+        if (prev == nullptr)
+        {
+            _head = curr->_next;
+        }
+        else
+        {
+            prev->_next = curr->_next;
+        }
+        _size -= curr->_occurrences;
+        if (n != curr)
+        {
+            destroy_node(curr);
+        }
+        else
+        {
+            if (_finger == curr)
+            {
+                _finger = nullptr;
+            }
+            _cache.forget(curr);
+        }
+        n->_next = nullptr;
+        node_handle h(n);
+        record(n->_value, -static_cast<std::int64_t>(n->_occurrences));
+        return h;
+    }
+
+    /**
+     * @brief Insert
+     * Inserisce il nodo di un handle senza allocazioni. Se il valore e' gia' presente
+     * le occorrenze vengono sommate e il nodo del handle viene liberato.
+     * @param nh Handle da svuotare
+     * @return const_iterator Iteratore all'elemento inserito, end() se nh e' vuoto
+     */
+    const_iterator insert(node_handle &&nh)
+    {
+        if (nh.empty())
+        {
+            return end();
+        }
+        node *n = nh._node;
+        node *curr = follows(_finger, n->_value) ? _finger : _head;
+        node *prev = nullptr;
+        _stats.on_lookup();
+        while (curr != nullptr && !equal(curr->_value, n->_value) && !compare(curr->_value, n->_value))
+        {
+            prev = curr;
+            curr = curr->_next;
+            _stats.on_hop();
+        }
+        count_type d = count_traits<CountT>::room(_size, n->_occurrences);
+        if (curr != nullptr && equal(curr->_value, n->_value))
+        {
+            d = count_traits<CountT>::room(curr->_occurrences, d);
+            if (curr->_occurrences == 0 && d > 0)
+            {
+                --_tombstones;
+            }
+            curr->_occurrences += d;
+            _size += d;
+            nh = node_handle();
+            _finger = curr;
+            record(curr->_value, d);
+            return const_iterator(curr);
+        }
+        if (d == 0)
+        {
+            nh = node_handle();
+            return end();
+        }
+        nh._node = nullptr;
+        n->_occurrences = d;
+        n->_next = curr;
+        if (prev == nullptr)
+        {
+            _head = n;
+        }
+        else
+        {
+            prev->_next = n;
+        }
+        _size += d;
+        record(n->_value, d);
+        _finger = n;
+        return const_iterator(n);
+    }
+
+    /**
+     * @brief Subtract
+     * Rimuove da questo multiset tutte le occorrenze di un altro multiset dello stesso tipo,
+     * con un solo passaggio sulle due liste: O(n + m)
+     * @param other Multiset da togliere
+     * @throw element_not_found_exception se other contiene piu' occorrenze di un valore
+     *  di questo multiset; in quel caso il multiset non viene modificato
+     */
+    void subtract(const multiset &other)
+    {
+        if (&other == this)
+        {
+            clear();
+            return;
+        }
+        purge();
+        // primo passaggio: controllo che ci siano tutte le occorrenze da togliere
+        node *curr = _head;
+        for (node *o = other._head; o != nullptr; o = o->_next)
+        {
+            if (o->_occurrences == 0)
+            {
+                continue;
+            }
+            while (curr != nullptr && !equal(curr->_value, o->_value) && !compare(curr->_value, o->_value))
+            {
+                curr = curr->_next;
+            }
+            if (curr == nullptr || !equal(curr->_value, o->_value) || curr->_occurrences < o->_occurrences)
+            {
+                throw element_not_found_exception("Error, element not found in multiset");
+            }
+        }
+
+        node *prev = nullptr;
+        curr = _head;
+        for (node *o = other._head; o != nullptr; o = o->_next)
+        {
+            if (o->_occurrences == 0)
+            {
+                continue;
+            }
+            while (!equal(curr->_value, o->_value))
+            {
+                prev = curr;
+                curr = curr->_next;
+            }
+            record(o->_value, -static_cast<std::int64_t>(o->_occurrences));
+            curr->_occurrences -= o->_occurrences;
+            _size -= o->_occurrences;
+            if (curr->_occurrences == 0)
+            {
+                node *next = curr->_next;
+                if (prev == nullptr)
+                {
+                    _head = next;
+                }
+                else
+                {
+                    prev->_next = next;
+                }
+                destroy_node(curr);
+                curr = next;
+            }
+        }
+    }
+
+    /**
+     * @brief Clear
+     * Svuota il multiset
+     */
+    void clear()
+    {
+        while (_head != nullptr)
+        {
+            node *tmp = _head;
+            record(tmp->_value, -static_cast<std::int64_t>(tmp->_occurrences));
+            _head = tmp->_next;
+            destroy_node(tmp);
+        }
+        _size = 0;
+        _tombstones = 0;
+    }
+
+    /**
+     * @brief Diff
+     * Ritorna le variazioni che trasformano from in to, con un solo passaggio sulle due liste: O(n + m).
+     * Contiene solo i valori le cui occorrenze cambiano, nell'ordine di Comp.
+     * @param from Multiset di partenza
+     * @param to Multiset di arrivo
+     * @return delta_type Variazioni da passare a from.apply
+     */
+    friend delta_type diff(const multiset &from, const multiset &to)
+    {
+        delta_type result;
+        const node *a = from._head;
+        const node *b = to._head;
+        while (a != nullptr || b != nullptr)
+        {
+            if (a != nullptr && a->_occurrences == 0)
+            {
+                a = a->_next;
+            }
+            else if (b != nullptr && b->_occurrences == 0)
+            {
+                b = b->_next;
+            }
+            else if (b == nullptr || (a != nullptr && from.compare(b->_value, a->_value)))
+            {
+                // il valore di a non e' in to
+                result.push_back(std::make_pair(a->_value, -static_cast<std::int64_t>(a->_occurrences)));
+                a = a->_next;
+            }
+            else if (a == nullptr || !from.equal(a->_value, b->_value))
+            {
+                // il valore di b non e' in from
+                result.push_back(std::make_pair(b->_value, static_cast<std::int64_t>(b->_occurrences)));
+                b = b->_next;
+            }
+            else
+            {
+                if (a->_occurrences != b->_occurrences)
+                {
+                    result.push_back(std::make_pair(b->_value, static_cast<std::int64_t>(b->_occurrences) -
+                                                                   static_cast<std::int64_t>(a->_occurrences)));
+                }
+                a = a->_next;
+                b = b->_next;
+            }
+        }
+        return result;
+    }
+
+    /**
+     * @brief Apply
+     * Applica le variazioni prodotte da diff o take_changes con un solo passaggio sulla lista: O(n + k).
+     * Il primo passaggio controlla tutte le variazioni, compresi i limiti di CountT, quindi se
+     * non sono valide il multiset non viene modificato.
+     * @param delta Variazioni nell'ordine di Comp, al massimo una per valore
+     * @throw invalid_format_exception se le variazioni non sono nell'ordine di Comp o un'aggiunta non sta in count_type
+     * @throw element_not_found_exception se una variazione toglie piu' occorrenze di quelle presenti
+     * @throw count_overflow_exception se con checked_count un contatore supererebbe il massimo
+     */
+    void apply(const delta_type &delta)
+    {
+        // primo passaggio: controllo ordine, occorrenze da togliere e contatori, simulando size()
+        node *curr = _head;
+        count_type size = _size;
+        for (std::size_t i = 0; i < delta.size(); ++i)
+        {
+            const T &value = delta[i].first;
+            if (i > 0 && !compare(value, delta[i - 1].first))
+            {
+                throw invalid_format_exception("Error, delta is not sorted");
+            }
+            while (curr != nullptr && !equal(curr->_value, value) && !compare(curr->_value, value))
+            {
+                curr = curr->_next;
+            }
+            bool found = curr != nullptr && equal(curr->_value, value);
+            if (delta[i].second > 0)
+            {
+                if (static_cast<std::uint64_t>(delta[i].second) > std::numeric_limits<count_type>::max())
+                {
+                    throw invalid_format_exception("Error, delta exceeds the count type");
+                }
+                count_type d = count_traits<CountT>::room(size, static_cast<count_type>(delta[i].second));
+                if (found)
+                {
+                    d = count_traits<CountT>::room(curr->_occurrences, d);
+                }
+                size += d;
+            }
+            else if (delta[i].second < 0)
+            {
+                // -(x + 1) + 1 evita l'overflow di -x con il minimo di int64_t
+                std::uint64_t r = static_cast<std::uint64_t>(-(delta[i].second + 1)) + 1;
+                if (!found || curr->_occurrences < r)
+                {
+                    throw element_not_found_exception("Error, element not found in multiset");
+                }
+                size -= static_cast<count_type>(r);
+            }
+        }
+
+        purge();
+        node *prev = nullptr;
+        curr = _head;
+        for (std::size_t i = 0; i < delta.size(); ++i)
+        {
+            const T &value = delta[i].first;
+            while (curr != nullptr && !equal(curr->_value, value) && !compare(curr->_value, value))
+            {
+                prev = curr;
+                curr = curr->_next;
+            }
+            bool found = curr != nullptr && equal(curr->_value, value);
+            if (delta[i].second > 0)
+            {
+                count_type d = count_traits<CountT>::room(_size, static_cast<count_type>(delta[i].second));
+                if (found)
+                {
+                    d = count_traits<CountT>::room(curr->_occurrences, d);
+                    curr->_occurrences += d;
+                }
+                else if (d > 0)
+                {
+                    node *n = create_node(value, curr);
+                    n->_occurrences = d;
+                    if (prev == nullptr)
+                    {
+                        _head = n;
+                    }
+                    else
+                    {
+                        prev->_next = n;
+                    }
+                    curr = n;
+                }
+                _size += d;
+                record(value, d);
+            }
+            else if (delta[i].second < 0)
+            {
+                count_type r = static_cast<count_type>(-(delta[i].second + 1)) + 1;
+                if (curr->_occurrences == r)
+                {
+                    curr = unlink(prev, curr);
+                }
+                else
+                {
+                    curr->_occurrences -= r;
+                    _size -= r;
+                    record(value, delta[i].second);
+                }
+            }
+        }
+    }
+
+    /**
+     * @brief Track Changes
+     * Attiva o disattiva la registrazione delle variazioni fatte da tutte le operazioni che
+     * modificano il multiset, da leggere con take_changes. In entrambi i casi le variazioni
+     * registrate finora vengono scartate. Copie e spostamenti non ereditano la registrazione.
+     * @param on true per attivare la registrazione
+     */
+    void track_changes(bool on)
+    {
+        _tracking = on;
+        _journal.clear();
+    }
+
+    /**
+     * @brief Tracking Changes
+     * Controlla se la registrazione delle variazioni e' attiva
+     */
+    bool tracking_changes() const { return _tracking; }
+
+    /**
+     * @brief Take Changes
+     * Ritorna le variazioni registrate dall'attivazione o dall'ultima chiamata, riunite per
+     * valore e nell'ordine di Comp, e ricomincia da zero. Applicate con apply a una copia del
+     * multiset fatta in quel momento la rendono uguale a questo.
+     * @return delta_type
+     */
+    delta_type take_changes()
+    {
+        std::stable_sort(_journal.begin(), _journal.end(),
+                         [this](const std::pair<T, std::int64_t> &a, const std::pair<T, std::int64_t> &b)
+                         { return compare(b.first, a.first); });
+        delta_type result;
+        for (std::size_t i = 0; i < _journal.size(); ++i)
+        {
+            if (!result.empty() && equal(result.back().first, _journal[i].first))
+            {
+                result.back().second += _journal[i].second;
+                if (result.back().second == 0)
+                {
+                    result.pop_back();
+                }
+            }
+            else
+            {
+                result.push_back(_journal[i]);
+            }
+        }
+        _journal.clear();
+        return result;
+    }
+
+    /** 
+     * @brief Contains
+     * Controlla se un valore è presente nel multiset
+     * @param value Valore da cercare
+    */
+    bool contains(const T &value) const
+    {
+        node *curr = cached(value);
+        _stats.on_lookup();
+        if (curr != nullptr)
+        {
+            return curr->_occurrences > 0;
+        }
+        curr = _head;
+        while (curr != nullptr)
+        {
+            if (equal(curr->_value, value))
+            {
+                _cache.store(value, curr);
+                return curr->_occurrences > 0;
+            }
+            curr = curr->_next;
+            _stats.on_hop();
+        }
+        return false;
+    }
+
+    /**
+     * @brief Is Empty
+     * Controlla se il multiset è vuoto 
+     * @return true 
+     * @return false 
+     */
+    bool isEmpty() const { return _size == 0; }
+
+    /**
+     * @brief Stats
+     * Ritorna le statistiche raccolte dalla politica Stats
+     */
+    const Stats &stats() const { return _stats; }
+
+    /**
+     * @brief Reset Stats
+     * Azzera le statistiche
+     */
+    void reset_stats() { _stats.reset(); }
+
+    /**
+     * @brief Cache
+     * Ritorna la cache delle ricerche scelta con la politica Cache, con i contatori hits() e misses()
+     */
+    const typename Cache::template table<T, node> &cache() const { return _cache; }
+
+    /**
+     * @brief Reset Cache Stats
+     * Azzera i contatori della cache, che resta piena
+     */
+    void reset_cache_stats() { _cache.reset(); }
+
+    /**
+     * @brief Distinct Count
+     * Ritorna il numero di valori distinti (nodi), mentre size() conta anche le occorrenze
+     */
+    std::size_t distinct_count() const
+    {
+        std::size_t n = 0;
+        for (node *curr = _head; curr != nullptr; curr = curr->_next)
+        {
+            ++n;
+        }
+        return n - _tombstones;
+    }
+
+    /**
+     * @brief Memory Usage
+     * Ritorna la memoria occupata dai nodi. L'overhead dell'allocatore e' stimato per malloc della glibc.
+     * sizeof(multiset) non e' compreso, tranne gli slot interni occupati o liberi.
+     */
+    multiset_memory memory_usage() const
+    {
+        multiset_memory m = {0, 0, 0, 0};
+        for (node *curr = _head; curr != nullptr; curr = curr->_next)
+        {
+            ++m.nodes;
+            if (!_inline.owns(curr) && (_slab == nullptr || !_slab->owns(curr)))
+            {
+                ++m.heap_nodes;
+            }
+        }
+        m.node_bytes = m.nodes * sizeof(node);
+        m.overhead_bytes = m.heap_nodes * (allocated_bytes(sizeof(node)) - sizeof(node));
+        if (_slab != nullptr)
+        {
+            m.overhead_bytes += (_slab->_capacity - _slab->_live) * sizeof(node) +
+                                allocated_bytes(_slab->_capacity * sizeof(node)) - _slab->_capacity * sizeof(node) +
+                                allocated_bytes(sizeof(slab));
+        }
+        std::size_t inline_nodes = m.nodes - m.heap_nodes - (_slab == nullptr ? 0 : _slab->_live);
+        m.overhead_bytes += (N - inline_nodes) * sizeof(node);
+        return m;
+    }
+
+    /**
+     * @brief Compact
+     * Sposta i nodi sullo heap in un unico blocco contiguo, nell'ordine della lista,
+     * e libera le allocazioni singole. Utile dopo molti add e remove per recuperare
+     * localita' e memoria. I nodi interni restano dove sono. O(n).
+     */
+    void compact()
+    {
+        purge();
+        std::size_t count = 0;
+        for (node *curr = _head; curr != nullptr; curr = curr->_next)
+        {
+            if (!_inline.owns(curr))
+            {
+                ++count;
+            }
+        }
+        // gia' compatto: nessun nodo fuori dal blocco e nessuno slot libero nel blocco
+        if (count == 0 || (_slab != nullptr && _slab->_live == count && _slab->_capacity == count))
+        {
+            return;
+        }
+
+        slab *fresh = new slab;
+        fresh->_capacity = count;
+        fresh->_live = 0;
+        try
+        {
+            fresh->_nodes = std::allocator<node>().allocate(count);
+        }
+        catch (...)
+        {
+            delete fresh;
+            throw;
+        }
+
+        // prima costruisco le copie: se una lancia il multiset resta com'era
+        try
+        {
+            for (node *curr = _head; curr != nullptr; curr = curr->_next)
+            {
+                if (!_inline.owns(curr))
+                {
+                    node *n = new (fresh->_nodes + fresh->_live) node(std::move_if_noexcept(curr->_value));
+                    n->_occurrences = curr->_occurrences;
+                    ++fresh->_live;
+                }
+            }
+        }
+        catch (...)
+        {
+            for (std::size_t i = 0; i < fresh->_live; ++i)
+            {
+                fresh->_nodes[i].~node();
+            }
+            std::allocator<node>().deallocate(fresh->_nodes, fresh->_capacity);
+            delete fresh;
+            throw;
+        }
+        _stats.on_allocate();
+
+        // poi ricollego la lista ai nuovi nodi e distruggo i vecchi
+        node *prev = nullptr;
+        std::size_t i = 0;
+        for (node *curr = _head; curr != nullptr; prev = curr, curr = curr->_next)
+        {
+            if (_inline.owns(curr))
+            {
+                continue;
+            }
+            node *n = fresh->_nodes + i++;
+            n->_next = curr->_next;
+            if (prev == nullptr)
+            {
+                _head = n;
+            }
+            else
+            {
+                prev->_next = n;
+            }
+            destroy_node(curr);
+            curr = n;
+        }
+        _slab = fresh;
+    }
+
+    /**
+     * @brief Shrink To Fit
+     * Sinonimo di compact
+     */
+    void shrink_to_fit() { compact(); }
+
+    /**
+     * @brief Set Tombstone Ratio
+     * Con ratio > 0 remove non libera il nodo dell'ultima occorrenza di un valore ma lo lascia
+     * nella lista come lapide (zero occorrenze): un nuovo add dello stesso valore lo riusa senza
+     * allocazioni. Le lapidi sono ignorate da iterazione, contains, size e distinct_count e vengono
+     * liberate tutte insieme da compact o quando diventano piu' di ratio * size() (e di min_tombstones,
+     * perche' un valore che va e viene in un multiset quasi vuoto non allochi a ogni add).
+     * Con ratio 0 (default) le lapidi esistenti vengono liberate e remove torna a liberare i nodi.
+     * @param ratio Numero massimo di lapidi per elemento
+     */
+    void set_tombstone_ratio(double ratio)
+    {
+        _tombstone_ratio = ratio > 0 ? ratio : 0;
+        if (_tombstone_ratio == 0 || too_many_tombstones())
+        {
+            purge();
+        }
+    }
 
-    node *_head;
-    unsigned int _size;
-    Comp _cmp;
-    Eq _eq;
+    /**
+     * @brief Tombstones
+     * Ritorna il numero di lapidi nella lista
+     */
+    std::size_t tombstones() const { return _tombstones; }
 
-public:
     /**
-     * @brief Costruttore di default
-     * Inizializza un nuovo multiset vuoto
+     * @brief Quantile
+     * Ritorna il q-quantile nell'ordine di iterazione (nearest rank): il primo elemento
+     * per cui gli elementi fino a lui compreso sono almeno ceil(q * size()).
+     * Scorre i nodi distinti sommando le occorrenze, senza visitare ogni occorrenza.
+     * @param q Quantile richiesto in [0, 1]
+     * @throw std::invalid_argument se q non e' in [0, 1]
+     * @throw element_not_found_exception se il multiset e' vuoto
      */
-    multiset() : _head(nullptr), _size(0) {}
+    const T &quantile(double q) const
+    {
+        count_type rank = quantile_rank(q);
+        count_type seen = 0;
+        node *curr = _head;
+        while (seen + curr->_occurrences < rank)
+        {
+            seen += curr->_occurrences;
+            curr = curr->_next;
+        }
+        return curr->_value;
+    }
 
     /**
-     * @brief Costruttore di copia
-     * Inizializza un nuovo multiset con un multiset passato come parametro
-     * @param other Multiset da copiare
+     * @brief Quantiles
+     * Ritorna piu' quantili con un solo passaggio sulla lista
+     * @param qs Quantili richiesti in [0, 1], in qualsiasi ordine
+     * @return std::vector<T> i quantili nello stesso ordine di qs
+     * @throw std::invalid_argument se un quantile non e' in [0, 1]
+     * @throw element_not_found_exception se il multiset e' vuoto
      */
-    multiset(const multiset &other) : _size(0), _head(nullptr)
+    std::vector<T> quantiles(const std::vector<double> &qs) const
     {
-        node *curr = other._head;
+        std::vector<std::pair<count_type, std::size_t> > ranks;
+        ranks.reserve(qs.size());
+        for (std::size_t i = 0; i < qs.size(); ++i)
+        {
+            ranks.push_back(std::make_pair(quantile_rank(qs[i]), i));
+        }
+        std::sort(ranks.begin(), ranks.end());
 
-        try
+        std::vector<const T *> found(qs.size(), nullptr);
+        count_type seen = 0;
+        node *curr = _head;
+        for (std::size_t i = 0; i < ranks.size(); ++i)
         {
-            while (curr != nullptr)
+            while (seen + curr->_occurrences < ranks[i].first)
             {
-                add(curr->_value);
+                seen += curr->_occurrences;
                 curr = curr->_next;
             }
+            found[ranks[i].second] = &curr->_value;
         }
-        catch (...)
+
+        std::vector<T> result;
+        result.reserve(qs.size());
+        for (std::size_t i = 0; i < found.size(); ++i)
         {
-            clear();
-            throw;
+            result.push_back(*found[i]);
         }
+        return result;
     }
 
     /**
-     * @brief Costruttore di copia tramite iteratore
-     * Inizializza un nuovo multiset con due iteratori passati come parametro
-     * @param begin Iteratore all'inizio del range
-     * @param end Iteratore alla fine del range
+     * @brief Histogram
+     * Conta gli elementi negli intervalli delimitati da edges, con un solo passaggio sui nodi.
+     * Il risultato ha edges.size() + 1 valori: il primo conta gli elementi che precedono edges[0],
+     * l'i-esimo quelli da edges[i - 1] compreso a edges[i] escluso, l'ultimo quelli da edges.back() in poi.
+     * @param edges Estremi degli intervalli, nell'ordine di iterazione del multiset
+     * @return std::vector<count_type>
      */
-    template <typename Iter>
-    multiset(Iter b, Iter e) : _head(nullptr), _size(0)
+    std::vector<count_type> histogram(const std::vector<T> &edges) const
     {
-        try
+        std::vector<count_type> result(edges.size() + 1, 0);
+        std::size_t bin = 0;
+        for (node *curr = _head; curr != nullptr; curr = curr->_next)
         {
-            for (; b != e; ++b)
+            // il nodo precede edges[bin] se edges[bin] andrebbe inserito dopo di lui
+            while (bin < edges.size() && !compare(edges[bin], curr->_value))
             {
-                add(static_cast<T>(*b));
+                ++bin;
             }
+            result[bin] += curr->_occurrences;
         }
-        catch (...)
-        {
-            clear();
-            throw;
-        }
+        return result;
     }
 
     /**
-     * @brief Operatore di assignement
-     * Assegna un multiset ad un altro multiset
-     * @param other Multiset da copiare
-     * @return multiset& Multiset copiato
+     * @brief Sample
+     * Estrae un elemento con probabilita' proporzionale alle sue occorrenze,
+     * scorrendo i nodi distinti: ogni estrazione costa O(numero di valori distinti), perche' la
+     * lista non tiene le somme parziali delle occorrenze che servirebbero per una ricerca in O(log n).
+     * Per molte estrazioni conviene sample_n (un solo passaggio per tutte) o, se il multiset non
+     * cambia piu', sampler (O(1) per estrazione).
+     * @param rng Generatore di numeri casuali (UniformRandomBitGenerator)
+     * @throw element_not_found_exception se il multiset e' vuoto
      */
-    multiset &operator=(const multiset &other)
+    template <typename Rng>
+    const T &sample(Rng &rng) const
     {
-        if (this != &other)
+        if (_size == 0)
         {
-            multiset tmp(other);
-            std::swap(_head, tmp._head);
-            std::swap(_size, tmp._size);
+            throw element_not_found_exception("Error, cannot sample from an empty multiset");
         }
-        return *this;
+        count_type rank = static_cast<count_type>(std::uniform_int_distribution<std::uint64_t>(1, _size)(rng));
+        count_type seen = 0;
+        node *curr = _head;
+        while (seen + curr->_occurrences < rank)
+        {
+            seen += curr->_occurrences;
+            curr = curr->_next;
+        }
+        return curr->_value;
     }
 
     /**
-     * @brief Operatore di uguaglianza
-     * Controlla se due multiset sono uguali confrontando tutti i valori dei nodi e il numero di occorrenze di ogni nodo
-     * E' templata per permettere la comparazione tra multiset di tipi diversi
-     * @param other Multiset da confrontare
-     * @return true 
-     * @return false 
+     * @brief Sample N
+     * Estrae n elementi indipendenti (con ripetizione) con un solo passaggio sulla lista,
+     * senza ordinare le estrazioni: O(n + numero di valori distinti).
+     * Le estrazioni che cadono su ogni nodo seguono una binomiale sulle estrazioni rimaste,
+     * con probabilita' pari alle occorrenze del nodo sul totale dei nodi non ancora visitati;
+     * il risultato viene poi mescolato, quindi l'ordine delle estrazioni e' casuale.
+     * @param rng Generatore di numeri casuali
+     * @param n Numero di estrazioni
+     * @throw element_not_found_exception se il multiset e' vuoto e n > 0
      */
-    template <typename T2, typename Comp2, typename Eq2>
-    bool operator==(const multiset<T2, Comp2, Eq2> &other) const
+    template <typename Rng>
+    std::vector<T> sample_n(Rng &rng, std::size_t n) const
     {
-        multiset tmp(other.begin(), other.end());
-        const_iterator it = begin();
-        const_iterator it2 = tmp.begin();
-        if (size() != tmp.size())
+        if (n > 0 && _size == 0)
         {
-            return false;
+            throw element_not_found_exception("Error, cannot sample from an empty multiset");
         }
-        while (it != end() && it2 != tmp.end())
+        std::vector<T> result;
+        result.reserve(n);
+        std::size_t left = n;
+        count_type rest = _size; // occorrenze dei nodi non ancora visitati
+        for (node *curr = _head; left > 0; curr = curr->_next)
         {
-            if (*it != *it2)
+            if (curr->_occurrences == 0)
             {
-                return false;
+                continue;
             }
-            ++it;
-            ++it2;
+            std::size_t hits = left;
+            if (curr->_occurrences < rest)
+            {
+                double p = static_cast<double>(curr->_occurrences) / static_cast<double>(rest);
+                hits = std::binomial_distribution<std::size_t>(left, p)(rng);
+            }
+            result.insert(result.end(), hits, curr->_value);
+            left -= hits;
+            rest -= curr->_occurrences;
         }
-        return it == end() && it2 == tmp.end();
+        std::shuffle(result.begin(), result.end(), rng);
+        return result;
     }
 
     /**
-     * @brief Operatore di disuguaglianza
-     * Controlla se due multiset sono diversi confrontando tutti i valori dei nodi e il numero di occorrenze di ogni nodo
-     * E' templata per permettere la comparazione tra multiset di tipi diversi
-     * @param other Multiset da confrontare
-     * @return true 
-     * @return false 
+     * @brief Sampler
+     * Ritorna un campionatore con tabella alias sul contenuto attuale del multiset,
+     * per estrazioni in O(1) quando il multiset non cambia piu'
      */
-    template <typename T2, typename Comp2, typename Eq2>
-    bool operator!=(const multiset<T2, Comp2, Eq2> &other) const
+    alias_sampler<T> sampler() const
     {
-        return !(*this == other);
+        std::vector<std::pair<T, std::uint64_t> > weights;
+        for (node *curr = _head; curr != nullptr; curr = curr->_next)
+        {
+            if (curr->_occurrences > 0)
+            {
+                weights.push_back(std::make_pair(curr->_value, static_cast<std::uint64_t>(curr->_occurrences)));
+            }
+        }
+        return alias_sampler<T>(weights);
     }
 
     /**
-     * @brief Size
-     * Ritorna il numero di nodi presenti nel multiset
-     * 
-     * @return int 
+     * @brief Distruttore
+     * Distrugge il multiset
      */
-    int size() const { return _size; }
+    ~multiset()
+    {
+        _tracking = false;
+        clear();
+    }
 
     /**
-     * @brief Get the Occurrences
-     * Ritorna il numero di occorrenze di un valore nel multiset
-     * @param value 
-     * @return int 
+     * @brief Serialize
+     * Scrive il multiset su uno stream in formato binario.
+     * I valori distinti sono scritti nell'ordine del multiset. Nel layout compatto le chiavi
+     * intere sono scritte come differenza dal valore precedente in varint (gli altri tipi byte
+     * per byte) e le occorrenze in varint; nel layout piatto chiavi e occorrenze sono scritte
+     * come array a dimensione fissa, leggibili senza copia da mapped_multiset.
+     * @param os Stream di output (aperto in modalita' binaria)
+     * @param l Layout del corpo del file
      */
-    int getOccurrences(const T &value) const
+    void serialize(std::ostream &os, multiset_io::layout l = multiset_io::layout_compact) const
     {
-        node *iter = _head;
-        while (iter != nullptr)
+        typedef typename std::is_integral<T>::type integral_key;
+
+        multiset_io::header h;
+        h.version = multiset_io::version;
+        h.layout = l;
+        h.encoding = l == multiset_io::layout_flat ? multiset_io::key_raw : multiset_io::encoding_for<T>();
+        h.key_size = sizeof(T);
+        h.distinct = 0;
+        h.total = _size;
+        h.distinct = distinct_count();
+
+        multiset_io::byte_writer w(os);
+        multiset_io::write_header(w, h);
+        if (l == multiset_io::layout_flat)
         {
-            if (_eq(iter->_value, value))
+            for (node *curr = _head; curr != nullptr; curr = curr->_next)
             {
-                return iter->_occurrences;
+                if (curr->_occurrences > 0)
+                {
+                    w.write(&curr->_value, sizeof(T));
+                }
+            }
+            w.pad(multiset_io::flat_counts_offset(h.distinct, sizeof(T)) -
+                  multiset_io::header_size - h.distinct * sizeof(T));
+            for (node *curr = _head; curr != nullptr; curr = curr->_next)
+            {
+                std::uint64_t occurrences = curr->_occurrences;
+                if (occurrences > 0)
+                {
+                    w.write(&occurrences, sizeof(occurrences));
+                }
+            }
+        }
+        else
+        {
+            std::uint64_t prev = 0;
+            for (node *curr = _head; curr != nullptr; curr = curr->_next)
+            {
+                if (curr->_occurrences > 0)
+                {
+                    multiset_io::write_key(w, curr->_value, prev, integral_key());
+                    w.put_varint(curr->_occurrences);
+                }
             }
-            iter = iter->_next;
         }
-        return 0;
     }
 
     /**
-     * @brief Add
-     * Aggiunge un valore al multiset
-     * @param value 
+     * @brief Deserialize
+     * Sostituisce il contenuto del multiset con quello letto da uno stream scritto da serialize.
+     * La catena di nodi viene costruita in un solo passaggio accodando i nodi, senza riordinare:
+     * se i valori non rispettano l'ordine di Comp viene lanciata una eccezione.
+     * In caso di errore il multiset non viene modificato.
+     * @param is Stream di input (aperto in modalita' binaria)
+     * @throw invalid_format_exception se i dati non sono un multiset valido per questo tipo
      */
-    void add(const T &value)
+    void deserialize(std::istream &is)
     {
-        node *tmp;
-        try
-        {
-            tmp = new node(value);
-        }
-        catch (...)
+        typedef typename std::is_integral<T>::type integral_key;
+
+        multiset_io::byte_reader r(is);
+        multiset_io::header h = multiset_io::read_header(r);
+        bool flat = h.layout == multiset_io::layout_flat;
+        if ((h.layout != multiset_io::layout_compact && !flat) ||
+            h.encoding != (flat ? multiset_io::key_raw : multiset_io::encoding_for<T>()) ||
+            h.key_size != sizeof(T))
         {
-            throw;
+            throw invalid_format_exception("Error, serialized multiset has a different key type");
         }
 
-        if (_head == nullptr)
+        multiset tmp;
+        node *tail = nullptr;
+        std::uint64_t total = 0;
+        if (flat)
         {
-            _head = tmp;
-            ++_size;
+            // nel layout piatto le occorrenze seguono tutte le chiavi
+            std::vector<T> keys;
+            std::uint64_t unused = 0;
+            keys.reserve(static_cast<std::size_t>(std::min<std::uint64_t>(h.distinct, 1 << 20)));
+            for (std::uint64_t i = 0; i < h.distinct; ++i)
+            {
+                keys.push_back(multiset_io::read_key<T>(r, unused, std::false_type()));
+            }
+            r.skip(multiset_io::flat_counts_offset(h.distinct, sizeof(T)) -
+                   multiset_io::header_size - h.distinct * sizeof(T));
+            for (std::uint64_t i = 0; i < h.distinct; ++i)
+            {
+                std::uint64_t occurrences;
+                r.read(&occurrences, sizeof(occurrences));
+                tail = tmp.append_loaded(tail, keys[i], occurrences);
+                total += occurrences;
+            }
         }
         else
         {
-            node *curr = _head;
-            node *prev = _head;
-            while (curr != nullptr)
+            std::uint64_t prev = 0;
+            for (std::uint64_t i = 0; i < h.distinct; ++i)
             {
-                if (_eq(curr->_value, tmp->_value))
-                {
-                    curr->_occurrences++;
-                    _size++;
-                    delete tmp;
-                    return;
-                }
-
-                if (!_cmp(curr->_value, tmp->_value))
-                {
-                    prev = curr;
-                    curr = curr->_next;
-                }
-                else
-                {
-                    if (curr == _head)
-                    {
-                        _head = tmp;
-                        tmp->_next = curr;
-                        _size++;
-                        return;
-                    }
-                    else
-                    {
-                        prev->_next = tmp;
-                        tmp->_next = curr;
-                        _size++;
-                        return;
-                    }
-                }
+                T value = multiset_io::read_key<T>(r, prev, integral_key());
+                std::uint64_t occurrences = r.get_varint();
+                tail = tmp.append_loaded(tail, value, occurrences);
+                total += occurrences;
             }
-            prev->_next = tmp;
-            _size++;
         }
+        if (total != h.total || total > std::numeric_limits<count_type>::max())
+        {
+            throw invalid_format_exception("Error, serialized multiset size mismatch");
+        }
+        tmp._size = static_cast<count_type>(total);
+
+        clear();
+        take(tmp);
     }
 
     /**
-     * @brief Remove
-     * Rimuove un valore dal multiset
-     * @param value 
+     * @brief Format
+     * Scrive il multiset su uno stream nel formato {<valore1, occorrenze1>, <valore2, occorrenze2>, ...}
+     * L'output passa da un buffer locale e non forza mai il flush dello stream; i valori
+     * aritmetici sono convertiti con std::to_chars (i floating point nella forma piu' breve
+     * che viene riletta esattamente), gli altri con l'operatore << del tipo. Per rileggerli con
+     * parse il testo di un valore non aritmetico non deve contenere ',', '>' o spazi.
+     * @param os
      */
-    void remove(const T &value)
+    void format(std::ostream &os) const
     {
-        node *curr = _head;
-        node *prev = _head;
-        while (curr != nullptr)
+        multiset_io::text_writer w(os);
+        w.put('{');
+        bool first = true;
+        for (node *curr = _head; curr != nullptr; curr = curr->_next)
         {
-            if (_eq(curr->_value, value))
+            if (curr->_occurrences == 0)
             {
-                if (curr->_occurrences > 1)
-                {
-                    curr->_occurrences--;
-                    _size--;
-                    return;
-                }
-                else
-                {
-                    if (curr == _head)
-                    {
-                        _head = curr->_next;
-                        delete curr;
-                        _size--;
-                        return;
-                    }
-                    else
-                    {
-                        prev->_next = curr->_next;
-                        delete curr;
-                        _size--;
-                        return;
-                    }
-                }
+                continue;
             }
-            prev = curr;
-            curr = curr->_next;
+            if (!first)
+            {
+                w.put(", ");
+            }
+            first = false;
+            w.put('<');
+            w.put_value(curr->_value);
+            w.put(", ");
+            w.put_value(static_cast<std::uint64_t>(curr->_occurrences));
+            w.put('>');
         }
-        // se arrivati a questo punto non è stato trovato l'elemento lancio una eccezione
-        throw element_not_found_exception("Error, element not found in multiset");
+        w.put('}');
+        w.flush();
     }
 
     /**
-     * @brief Clear
-     * Svuota il multiset
+     * @brief Parse
+     * Sostituisce il contenuto del multiset con quello letto da uno stream nel formato scritto da format.
+     * Lo stream viene letto un carattere alla volta fino alla '}' finale, senza caricarlo in memoria.
+     * Se i valori sono nell'ordine di Comp (come quelli scritti da un multiset dello stesso tipo)
+     * i nodi vengono accodati e il tempo e' lineare; i valori fuori ordine vengono inseriti con
+     * una ricerca. In caso di errore il multiset non viene modificato.
+     * @param is
+     * @throw invalid_format_exception se il testo non rispetta il formato
      */
-    void clear()
+    void parse(std::istream &is)
     {
-        node *curr = _head;
-        while (curr != nullptr)
-        {
-            node *tmp = curr;
-            curr = curr->_next;
-            delete tmp;
-        }
-        _head = nullptr;
-        _size = 0;
-    }
+        multiset_io::text_reader r(is);
+        multiset tmp;
+        node *tail = nullptr;
+        std::uint64_t total = 0;
 
-    /** 
-     * @brief Contains
-     * Controlla se un valore è presente nel multiset
-     * @param value Valore da cercare
-    */
-    bool contains(const T &value) const
-    {
-        node *curr = _head;
-        while (curr != nullptr)
+        r.expect('{');
+        if (!r.accept('}'))
         {
-            if (_eq(curr->_value, value))
+            do
             {
-                return true;
-            }
-            curr = curr->_next;
-        }
-        return false;
-    }
+                r.expect('<');
+                T value = r.get_value<T>();
+                r.expect(',');
+                std::uint64_t occurrences = r.get_count();
+                r.expect('>');
+                if (occurrences == 0 || occurrences > std::numeric_limits<count_type>::max() - total)
+                {
+                    r.fail();
+                }
+                total += occurrences;
 
-    /**
-     * @brief Is Empty
-     * Controlla se il multiset è vuoto 
-     * @return true 
-     * @return false 
-     */
-    bool isEmpty() const { return _size == 0; }
+                if (tail == nullptr || compare(value, tail->_value))
+                {
+                    node *n = tmp.create_node(value, nullptr);
+                    n->_occurrences = static_cast<count_type>(occurrences);
+                    if (tail == nullptr)
+                    {
+                        tmp._head = n;
+                    }
+                    else
+                    {
+                        tail->_next = n;
+                    }
+                    tail = n;
+                }
+                else if (equal(value, tail->_value))
+                {
+                    tail->_occurrences += static_cast<count_type>(occurrences);
+                }
+                else
+                {
+                    tmp.insert_occurrences(value, static_cast<count_type>(occurrences));
+                }
+            } while (r.accept(','));
+            r.expect('}');
+        }
+        tmp._size = static_cast<count_type>(total);
 
-    /**
-     * @brief Distruttore
-     * Distrugge il multiset
-     */
-    ~multiset()
-    {
         clear();
+        take(tmp);
     }
 
     /**
      * @brief Operatore <<
      * Stampa su uno stream il multiset nel formato <valore1, occorrenze1>, <valore2, occorrenze2>, ...
+     * seguito da un a capo, senza forzare il flush dello stream
      * @param os 
      * @param m 
      * @return std::ostream& 
      */
-    friend std::ostream &operator<<(std::ostream &os, const multiset<T, Comp, Eq> &m)
+    friend std::ostream &operator<<(std::ostream &os, const multiset &m)
     {
-        node *curr = m._head;
-        os << "{";
-        while (curr != nullptr)
-        {
-            os << "<" << curr->_value << ", " << curr->_occurrences << ">";
-            curr = curr->_next;
-            if (curr != nullptr)
-            {
-                os << ", ";
-            }
-        }
-        os << "}" << std::endl;
+        m.format(os);
+        os << '\n';
 
         return os;
     }
@@ -440,15 +2363,17 @@ public:
         typedef const T &reference;
 
         // Costruttore di default
-        const_iterator() : ptr(nullptr) {}
+        const_iterator() : ptr(nullptr), _prev(nullptr) {}
         // Copy constructor
-        const_iterator(const const_iterator &other) : ptr(other.ptr) {}
+        const_iterator(const const_iterator &other) : ptr(other.ptr), _prev(other._prev), _counter(other._counter) {}
         // Operatore di assegnamento
         const_iterator &operator=(const const_iterator &other)
         {
             if (this != &other)
             {
                 ptr = other.ptr;
+                _prev = other._prev;
+                _counter = other._counter;
             }
             return *this;
         }
@@ -457,8 +2382,10 @@ public:
         {
             if (_counter == ptr->_occurrences)
             {
+                _prev = ptr;
                 ptr = ptr->_next;
                 _counter = 1;
+                skip_tombstones();
             }
             else
             {
@@ -473,8 +2400,10 @@ public:
             const_iterator tmp(*this);
             if (_counter == ptr->_occurrences)
             {
+                _prev = ptr;
                 ptr = ptr->_next;
                 _counter = 1;
+                skip_tombstones();
             }
             else
             {
@@ -504,16 +2433,31 @@ public:
             return &(ptr->_value);
         }
         // Ritorna il numero di occorrenze dell'elemento puntato
-        int occurrences() const
+        count_type occurrences() const
         {
             return ptr->_occurrences;
         }
 
     private:
         friend class multiset;
-        const_iterator(node *p) : ptr(p) {}
+        const_iterator(node *p) : ptr(p), _prev(nullptr) {}
+        // Salta i nodi senza occorrenze lasciati da remove
+        void skip_tombstones()
+        {
+            while (ptr != nullptr && ptr->_occurrences == 0)
+            {
+                _prev = ptr;
+                ptr = ptr->_next;
+            }
+        }
+        const_iterator(node *p, node *prev, count_type counter) : ptr(p), _prev(prev), _counter(counter)
+        {
+            skip_tombstones();
+        }
         node *ptr;
-        unsigned int _counter = 1;
+        // nodo precedente, noto se l'iteratore e' arrivato qui scorrendo la lista; usato da erase
+        node *_prev;
+        count_type _counter = 1;
     };
     /**
      * @brief Ritorna un iteratore costante all'inizio del multiset
@@ -522,7 +2466,9 @@ public:
      */
     const_iterator begin() const
     {
-        return const_iterator(_head);
+        const_iterator it(_head);
+        it.skip_tombstones();
+        return it;
     }
     /**
      * @brief Ritorna un iteratore costante alla fine del multiset
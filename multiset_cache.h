@@ -0,0 +1,116 @@
+#ifndef MULTISET_CACHE_H
+#define MULTISET_CACHE_H
+
+#include <cstddef>
+#include <cstdint>
+
+/**
+ * @brief Politica di cache vuota, usata di default da multiset
+ * Ogni ricerca scorre la lista; i metodi vuoti vengono eliminati dal compilatore.
+ */
+struct no_cache
+{
+    template <typename T, typename Node>
+    struct table
+    {
+        Node *find(const T &) const { return nullptr; }
+        void store(const T &, Node *) {}
+        void forget(const Node *) {}
+        void clear() {}
+        void hit() {}
+        void miss() {}
+        std::uint64_t hits() const { return 0; }
+        std::uint64_t misses() const { return 0; }
+        void reset() {}
+    };
+};
+
+/**
+ * @brief Cache a mappatura diretta dei nodi cercati di recente
+ * Da usare come parametro Cache, ad esempio multiset<int, Comp, Eq, unsigned int, 0, no_stats, mru_cache<std::hash<int> > >.
+ * Ogni valore ha un solo slot, scelto dal suo hash; l'ultimo nodo trovato sostituisce quello precedente.
+ * getOccurrences, contains, add e remove controllano lo slot prima di scorrere la lista, quindi
+ * le interrogazioni ripetute sugli stessi valori costano una chiamata a Hash e una a Eq.
+ * @tparam Hash funtore di hash sui valori
+ * @tparam Slots numero di slot
+ */
+template <typename Hash, std::size_t Slots = 16>
+struct mru_cache
+{
+    static_assert(Slots > 0, "mru_cache needs at least one slot");
+
+    template <typename T, typename Node>
+    class table
+    {
+        Node *_slots[Slots];
+        std::uint64_t _hits;
+        std::uint64_t _misses;
+        Hash _hash;
+
+        std::size_t index(const T &value) const { return _hash(value) % Slots; }
+
+    public:
+        table() : _hits(0), _misses(0) { clear(); }
+
+        // Copie e spostamenti partono con la cache vuota: i nodi appartengono al multiset di origine
+        table(const table &other) : _hits(0), _misses(0), _hash(other._hash) { clear(); }
+
+        table &operator=(const table &)
+        {
+            clear();
+            return *this;
+        }
+
+        // Nodo nello slot di value, da confermare con il funtore di equivalenza
+        Node *find(const T &value) const { return _slots[index(value)]; }
+
+        void store(const T &value, Node *n) { _slots[index(value)] = n; }
+
+        // Il valore del nodo puo' essere gia' stato spostato: lo slot si cerca per indirizzo
+        void forget(const Node *n)
+        {
+            for (std::size_t i = 0; i < Slots; ++i)
+            {
+                if (_slots[i] == n)
+                {
+                    _slots[i] = nullptr;
+                }
+            }
+        }
+
+        void clear()
+        {
+            for (std::size_t i = 0; i < Slots; ++i)
+            {
+                _slots[i] = nullptr;
+            }
+        }
+
+        void hit() { ++_hits; }
+        void miss() { ++_misses; }
+
+        /**
+         * @brief Hits
+         * Ritorna il numero di ricerche risolte dalla cache
+         */
+        std::uint64_t hits() const { return _hits; }
+
+        /**
+         * @brief Misses
+         * Ritorna il numero di ricerche che hanno dovuto scorrere la lista
+         */
+        std::uint64_t misses() const { return _misses; }
+
+        /**
+         * @brief Reset
+         * Azzera i contatori, senza svuotare la cache
+         */
+        void reset()
+        {
+            _hits = 0;
+            _misses = 0;
+        }
+    };
+};
+
+#endif
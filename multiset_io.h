@@ -0,0 +1,552 @@
+#ifndef MULTISET_IO_H
+#define MULTISET_IO_H
+
+#include <istream>
+#include <ostream>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <charconv>
+#include <cctype>
+#include <sstream>
+#include <string>
+#include <type_traits>
+#include "invalid_format_exception.h"
+
+/**
+ * @brief Funzioni di supporto per il formato binario dei multiset
+ *
+ * Il formato e' composto da un header di dimensione fissa seguito dai nodi
+ * distinti nell'ordine del multiset:
+ *  - magic "MSET", versione, layout, codifica della chiave, sizeof(T)
+ *  - numero di valori distinti e numero totale di occorrenze (uint64 little endian)
+ *  - layout compatto: per ogni nodo la chiave (delta zigzag varint per i tipi interi,
+ *    byte grezzi altrimenti) seguita dalle occorrenze in varint
+ *  - layout piatto: l'array delle chiavi (byte grezzi), allineato a 8 byte, seguito
+ *    dall'array delle occorrenze (uint64 nativi). Pensato per essere mappato in memoria
+ *    con mapped_multiset sulla stessa macchina che lo ha scritto
+ */
+namespace multiset_io
+{
+    const char magic[4] = {'M', 'S', 'E', 'T'};
+    const std::uint8_t version = 1;
+    const std::size_t header_size = 24;
+
+    /**
+     * @brief Layout del corpo del file
+     */
+    enum layout : std::uint8_t
+    {
+        layout_compact = 0,
+        layout_flat = 1
+    };
+
+    /**
+     * @brief Codifica delle chiavi
+     */
+    enum key_encoding : std::uint8_t
+    {
+        key_delta_varint = 0,
+        key_raw = 1
+    };
+
+    /**
+     * @brief Header di un multiset serializzato
+     */
+    struct header
+    {
+        std::uint8_t version;
+        std::uint8_t layout;
+        std::uint8_t encoding;
+        std::uint8_t key_size;
+        std::uint64_t distinct;
+        std::uint64_t total;
+    };
+
+    /**
+     * @brief Ritorna la codifica usata per le chiavi di tipo T
+     * I tipi interi sono codificati a delta, gli altri tipi trivially copyable byte per byte
+     */
+    template <typename T>
+    key_encoding encoding_for()
+    {
+        static_assert(std::is_integral<T>::value || std::is_trivially_copyable<T>::value,
+                      "multiset serialization requires an integral or trivially copyable T");
+        return std::is_integral<T>::value ? key_delta_varint : key_raw;
+    }
+
+    /**
+     * @brief Ritorna l'offset dell'array delle occorrenze nel layout piatto
+     * @param distinct Numero di valori distinti
+     * @param key_size Dimensione in byte di una chiave
+     */
+    inline std::uint64_t flat_counts_offset(std::uint64_t distinct, std::uint64_t key_size)
+    {
+        return (header_size + distinct * key_size + 7) & ~static_cast<std::uint64_t>(7);
+    }
+
+    /**
+     * @brief Scrittore di byte su uno stream
+     * Scrive direttamente sullo streambuf associato, che fa gia' da buffer
+     */
+    class byte_writer
+    {
+    public:
+        explicit byte_writer(std::ostream &os) : _os(os), _sb(os.rdbuf()) {}
+
+        void put(std::uint8_t b)
+        {
+            if (_sb->sputc(static_cast<char>(b)) == std::char_traits<char>::eof())
+            {
+                _os.setstate(std::ios_base::badbit);
+            }
+        }
+
+        void write(const void *data, std::size_t n)
+        {
+            std::streamsize len = static_cast<std::streamsize>(n);
+            if (_sb->sputn(static_cast<const char *>(data), len) != len)
+            {
+                _os.setstate(std::ios_base::badbit);
+            }
+        }
+
+        // Scrive n byte a zero
+        void pad(std::size_t n)
+        {
+            for (std::size_t i = 0; i < n; ++i)
+            {
+                put(0);
+            }
+        }
+
+        // Scrive un intero senza segno a 64 bit in little endian
+        void put_u64(std::uint64_t v)
+        {
+            for (int i = 0; i < 8; ++i)
+            {
+                put(static_cast<std::uint8_t>(v >> (8 * i)));
+            }
+        }
+
+        // Scrive un intero senza segno in formato varint (7 bit per byte)
+        void put_varint(std::uint64_t v)
+        {
+            while (v >= 0x80)
+            {
+                put(static_cast<std::uint8_t>(v | 0x80));
+                v >>= 7;
+            }
+            put(static_cast<std::uint8_t>(v));
+        }
+
+    private:
+        std::ostream &_os;
+        std::streambuf *_sb;
+    };
+
+    /**
+     * @brief Lettore di byte da uno stream
+     * Legge solo i byte necessari, lasciando il resto dello stream intatto.
+     * Lancia invalid_format_exception se lo stream termina prima del previsto
+     */
+    class byte_reader
+    {
+    public:
+        explicit byte_reader(std::istream &is) : _is(is), _sb(is.rdbuf()) {}
+
+        std::uint8_t get()
+        {
+            std::char_traits<char>::int_type c = _sb->sbumpc();
+            if (c == std::char_traits<char>::eof())
+            {
+                truncated();
+            }
+            return static_cast<std::uint8_t>(c);
+        }
+
+        void read(void *data, std::size_t n)
+        {
+            std::streamsize len = static_cast<std::streamsize>(n);
+            if (_sb->sgetn(static_cast<char *>(data), len) != len)
+            {
+                truncated();
+            }
+        }
+
+        void skip(std::size_t n)
+        {
+            for (std::size_t i = 0; i < n; ++i)
+            {
+                get();
+            }
+        }
+
+        std::uint64_t get_u64()
+        {
+            std::uint64_t v = 0;
+            for (int i = 0; i < 8; ++i)
+            {
+                v |= static_cast<std::uint64_t>(get()) << (8 * i);
+            }
+            return v;
+        }
+
+        std::uint64_t get_varint()
+        {
+            std::uint64_t v = 0;
+            for (int shift = 0; shift < 64; shift += 7)
+            {
+                std::uint8_t b = get();
+                v |= static_cast<std::uint64_t>(b & 0x7f) << shift;
+                if ((b & 0x80) == 0)
+                {
+                    return v;
+                }
+            }
+            throw invalid_format_exception("Error, malformed varint in serialized multiset");
+        }
+
+    private:
+        void truncated()
+        {
+            _is.setstate(std::ios_base::eofbit | std::ios_base::failbit);
+            throw invalid_format_exception("Error, unexpected end of serialized multiset");
+        }
+
+        std::istream &_is;
+        std::streambuf *_sb;
+    };
+
+    inline std::uint64_t zigzag(std::uint64_t delta)
+    {
+        return (delta << 1) ^ (0 - (delta >> 63));
+    }
+
+    inline std::uint64_t unzigzag(std::uint64_t v)
+    {
+        return (v >> 1) ^ (0 - (v & 1));
+    }
+
+    inline void write_header(byte_writer &w, const header &h)
+    {
+        w.write(magic, sizeof(magic));
+        w.put(h.version);
+        w.put(h.layout);
+        w.put(h.encoding);
+        w.put(h.key_size);
+        w.put_u64(h.distinct);
+        w.put_u64(h.total);
+    }
+
+    inline header read_header(byte_reader &r)
+    {
+        char m[4];
+        r.read(m, sizeof(m));
+        if (std::memcmp(m, magic, sizeof(magic)) != 0)
+        {
+            throw invalid_format_exception("Error, not a serialized multiset");
+        }
+        header h;
+        h.version = r.get();
+        h.layout = r.get();
+        h.encoding = r.get();
+        h.key_size = r.get();
+        h.distinct = r.get_u64();
+        h.total = r.get_u64();
+        if (h.version != version)
+        {
+            throw invalid_format_exception("Error, unsupported serialized multiset version");
+        }
+        return h;
+    }
+
+    /**
+     * @brief Scrive una chiave
+     * I tipi interi sono scritti come differenza zigzag rispetto alla chiave precedente
+     * @param prev Chiave precedente (come intero a 64 bit), aggiornata con la chiave corrente
+     */
+    template <typename T>
+    void write_key(byte_writer &w, const T &value, std::uint64_t &prev, std::true_type)
+    {
+        std::uint64_t u = static_cast<std::uint64_t>(value);
+        w.put_varint(zigzag(u - prev));
+        prev = u;
+    }
+
+    template <typename T>
+    void write_key(byte_writer &w, const T &value, std::uint64_t &, std::false_type)
+    {
+        w.write(&value, sizeof(T));
+    }
+
+    template <typename T>
+    T read_key(byte_reader &r, std::uint64_t &prev, std::true_type)
+    {
+        prev += unzigzag(r.get_varint());
+        return static_cast<T>(prev);
+    }
+
+    template <typename T>
+    T read_key(byte_reader &r, std::uint64_t &, std::false_type)
+    {
+        T value;
+        r.read(&value, sizeof(T));
+        return value;
+    }
+
+    /**
+     * @brief Categorie di valori per il formato testuale {<valore, occorrenze>, ...}
+     * I caratteri sono scritti cosi' come sono, i numeri con std::to_chars,
+     * tutti gli altri tipi con gli operatori di stream
+     */
+    enum text_category
+    {
+        text_char,
+        text_bool,
+        text_number,
+        text_stream
+    };
+
+    template <typename V>
+    struct text_kind
+        : std::integral_constant<int,
+                                 std::is_same<V, char>::value || std::is_same<V, signed char>::value ||
+                                         std::is_same<V, unsigned char>::value
+                                     ? text_char
+                                 : std::is_same<V, bool>::value ? text_bool
+                                 : std::is_arithmetic<V>::value ? text_number
+                                                                : text_stream>
+    {
+    };
+
+    /**
+     * @brief Scrittore testuale bufferizzato
+     * Accumula l'output in un buffer locale e lo scrive sullo stream a blocchi,
+     * senza mai forzare il flush dello stream
+     */
+    class text_writer
+    {
+    public:
+        explicit text_writer(std::ostream &os) : _os(os), _used(0) {}
+
+        void put(char c)
+        {
+            if (_used == sizeof(_buf))
+            {
+                flush();
+            }
+            _buf[_used++] = c;
+        }
+
+        void put(const char *s)
+        {
+            while (*s != '\0')
+            {
+                put(*s++);
+            }
+        }
+
+        template <typename V>
+        void put_value(const V &v)
+        {
+            put_value(v, std::integral_constant<int, text_kind<V>::value>());
+        }
+
+        void flush()
+        {
+            if (_used > 0)
+            {
+                _os.write(_buf, _used);
+                _used = 0;
+            }
+        }
+
+    private:
+        template <typename V>
+        void put_value(const V &v, std::integral_constant<int, text_char>)
+        {
+            put(static_cast<char>(v));
+        }
+
+        template <typename V>
+        void put_value(const V &v, std::integral_constant<int, text_bool>)
+        {
+            put(v ? '1' : '0');
+        }
+
+        template <typename V>
+        void put_value(const V &v, std::integral_constant<int, text_number>)
+        {
+            // 64 caratteri bastano per qualunque intero o floating point in forma piu' breve
+            if (sizeof(_buf) - _used < 64)
+            {
+                flush();
+            }
+            std::to_chars_result r = std::to_chars(_buf + _used, _buf + sizeof(_buf), v);
+            _used = r.ptr - _buf;
+        }
+
+        template <typename V>
+        void put_value(const V &v, std::integral_constant<int, text_stream>)
+        {
+            flush();
+            _os << v;
+        }
+
+        std::ostream &_os;
+        char _buf[4096];
+        std::size_t _used;
+    };
+
+    /**
+     * @brief Lettore testuale del formato {<valore, occorrenze>, ...}
+     * Legge dallo streambuf un carattere alla volta, senza consumare nulla dopo la '}' finale.
+     * Lancia invalid_format_exception se il testo non rispetta il formato
+     */
+    class text_reader
+    {
+    public:
+        explicit text_reader(std::istream &is) : _is(is), _sb(is.rdbuf()) {}
+
+        std::char_traits<char>::int_type peek()
+        {
+            return _sb->sgetc();
+        }
+
+        char get()
+        {
+            std::char_traits<char>::int_type c = _sb->sbumpc();
+            if (c == std::char_traits<char>::eof())
+            {
+                fail();
+            }
+            return std::char_traits<char>::to_char_type(c);
+        }
+
+        void skip_ws()
+        {
+            std::char_traits<char>::int_type c = peek();
+            while (c != std::char_traits<char>::eof() && std::isspace(c))
+            {
+                c = _sb->snextc();
+            }
+        }
+
+        // Salta gli spazi e consuma il carattere c, fallendo se non e' presente
+        void expect(char c)
+        {
+            skip_ws();
+            if (get() != c)
+            {
+                fail();
+            }
+        }
+
+        // Salta gli spazi e consuma il carattere c solo se e' presente
+        bool accept(char c)
+        {
+            skip_ws();
+            if (peek() == std::char_traits<char>::to_int_type(c))
+            {
+                _sb->sbumpc();
+                return true;
+            }
+            return false;
+        }
+
+        std::uint64_t get_count()
+        {
+            return get_value<std::uint64_t>();
+        }
+
+        template <typename V>
+        V get_value()
+        {
+            V v;
+            get_value(v, std::integral_constant<int, text_kind<V>::value>());
+            return v;
+        }
+
+        void fail()
+        {
+            _is.setstate(std::ios_base::failbit);
+            throw invalid_format_exception("Error, malformed multiset text");
+        }
+
+    private:
+        // Legge un token fino al primo separatore del formato
+        std::size_t token(char *buf, std::size_t cap)
+        {
+            skip_ws();
+            std::size_t len = 0;
+            std::char_traits<char>::int_type c = peek();
+            while (c != std::char_traits<char>::eof() && c != ',' && c != '>' && c != '}' && !std::isspace(c))
+            {
+                if (len == cap)
+                {
+                    fail();
+                }
+                buf[len++] = std::char_traits<char>::to_char_type(c);
+                c = _sb->snextc();
+            }
+            return len;
+        }
+
+        // Il carattere segue subito la '<' e puo' essere anche uno spazio o un separatore
+        template <typename V>
+        void get_value(V &v, std::integral_constant<int, text_char>)
+        {
+            v = static_cast<V>(get());
+        }
+
+        template <typename V>
+        void get_value(V &v, std::integral_constant<int, text_bool>)
+        {
+            char buf[2];
+            std::size_t len = token(buf, sizeof(buf));
+            if (len != 1 || (buf[0] != '0' && buf[0] != '1'))
+            {
+                fail();
+            }
+            v = buf[0] == '1';
+        }
+
+        template <typename V>
+        void get_value(V &v, std::integral_constant<int, text_number>)
+        {
+            char buf[128];
+            std::size_t len = token(buf, sizeof(buf));
+            std::from_chars_result r = std::from_chars(buf, buf + len, v);
+            if (len == 0 || r.ec != std::errc() || r.ptr != buf + len)
+            {
+                fail();
+            }
+        }
+
+        // Il valore e' il testo fino alla ',' o alla '>' successiva, letto con l'operatore >> del tipo:
+        // l'operatore si fermerebbe al primo spazio e per i tipi come std::string consumerebbe la ','
+        template <typename V>
+        void get_value(V &v, std::integral_constant<int, text_stream>)
+        {
+            skip_ws();
+            std::string text;
+            std::char_traits<char>::int_type c = peek();
+            while (c != std::char_traits<char>::eof() && c != ',' && c != '>')
+            {
+                text.push_back(std::char_traits<char>::to_char_type(c));
+                c = _sb->snextc();
+            }
+            std::istringstream is(text);
+            if (!(is >> v) || !(is >> std::ws).eof())
+            {
+                fail();
+            }
+        }
+
+        std::istream &_is;
+        std::streambuf *_sb;
+    };
+}
+
+#endif
@@ -0,0 +1,90 @@
+#ifndef MULTISET_STATS_H
+#define MULTISET_STATS_H
+
+#include <cstddef>
+#include <cstdint>
+
+/**
+ * @brief Politica di statistiche vuota, usata di default da multiset
+ * Tutti i metodi sono vuoti e vengono eliminati dal compilatore: il multiset non paga nulla.
+ */
+struct no_stats
+{
+    void on_compare() {}
+    void on_equal() {}
+    void on_lookup() {}
+    void on_hop() {}
+    void on_allocate() {}
+    void on_deallocate() {}
+    void on_not_found() {}
+    void reset() {}
+};
+
+/**
+ * @brief Politica di statistiche che conta le operazioni interne di multiset
+ * Da usare come parametro Stats, ad esempio multiset<int, Comp, Eq, unsigned int, 0, counting_stats>.
+ * I contatori non sono atomici: un multiset condiviso tra thread va protetto come gli altri suoi metodi.
+ */
+struct counting_stats
+{
+    std::uint64_t comparisons;     // chiamate al funtore di comparazione
+    std::uint64_t equalities;      // chiamate al funtore di equivalenza
+    std::uint64_t lookups;         // ricerche di un valore (add, remove, getOccurrences, contains)
+    std::uint64_t hops;            // nodi attraversati dalle ricerche
+    std::uint64_t allocations;     // nodi allocati sullo heap
+    std::uint64_t deallocations;   // nodi liberati dallo heap
+    std::uint64_t not_found;       // eccezioni lanciate da remove
+
+    counting_stats() { reset(); }
+
+    void on_compare() { ++comparisons; }
+    void on_equal() { ++equalities; }
+    void on_lookup() { ++lookups; }
+    void on_hop() { ++hops; }
+    void on_allocate() { ++allocations; }
+    void on_deallocate() { ++deallocations; }
+    void on_not_found() { ++not_found; }
+
+    /**
+     * @brief Reset
+     * Azzera tutti i contatori
+     */
+    void reset()
+    {
+        comparisons = 0;
+        equalities = 0;
+        lookups = 0;
+        hops = 0;
+        allocations = 0;
+        deallocations = 0;
+        not_found = 0;
+    }
+
+    /**
+     * @brief Hops Per Lookup
+     * Ritorna il numero medio di nodi attraversati per ricerca
+     */
+    double hops_per_lookup() const
+    {
+        return lookups == 0 ? 0 : static_cast<double>(hops) / static_cast<double>(lookups);
+    }
+};
+
+/**
+ * @brief Memoria occupata dai nodi di un multiset, ritornata da multiset::memory_usage
+ */
+struct multiset_memory
+{
+    std::size_t nodes;             // nodi (valori distinti)
+    std::size_t heap_nodes;        // nodi allocati singolarmente sullo heap
+    std::size_t node_bytes;        // byte occupati dai nodi
+    std::size_t overhead_bytes;    // byte persi: intestazioni dell'allocatore, slot liberi dei blocchi e degli slot interni
+
+    /**
+     * @brief Total
+     * Ritorna i byte complessivi di nodi e overhead
+     */
+    std::size_t total() const { return node_bytes + overhead_bytes; }
+};
+
+#endif
@@ -0,0 +1,594 @@
+#ifndef RANKED_MULTISET_H
+#define RANKED_MULTISET_H
+
+#include <ostream>
+#include <iterator>
+#include <cstddef>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+#include "element_not_found_exception.h"
+#include "count_traits.h"
+
+/**
+ * @brief Multiset con indice delle frequenze
+ *
+ * Oltre alla lista ordinata secondo Comp, come in multiset, i valori sono raggruppati per
+ * numero di occorrenze in una lista doppiamente concatenata di bucket ordinata per conteggio
+ * (come in una cache LFU). add e remove spostano il valore nel bucket adiacente in O(1) dopo
+ * la ricerca nella lista, quindi i valori piu' frequenti sono sempre disponibili:
+ * most_frequent() costa O(1) e top_k(k) O(k).
+ *
+ * @tparam T tipo del dato
+ * @tparam Comp funtore di comparazione
+ * @tparam Eq funtore di equivalenza
+ * @tparam CountT tipo delle occorrenze (vedi multiset)
+ */
+template <typename T, typename Comp, typename Eq, typename CountT = unsigned int>
+class ranked_multiset
+{
+public:
+    typedef typename count_traits<CountT>::type count_type;
+
+private:
+    struct bucket;
+
+    /**
+     * @brief Elemento del multiset
+     * _next segue l'ordine dei valori, _prev_rank e _next_rank collegano gli elementi
+     * dello stesso bucket
+     */
+    struct entry
+    {
+        T _value;
+        count_type _occurrences;
+        entry *_next;
+        entry *_prev_rank;
+        entry *_next_rank;
+        bucket *_bucket;
+
+        entry(const T &value, entry *next)
+            : _value(value), _occurrences(0), _next(next), _prev_rank(nullptr), _next_rank(nullptr), _bucket(nullptr) {}
+    };
+
+    /**
+     * @brief Gruppo degli elementi con lo stesso numero di occorrenze
+     * _lower e _higher puntano ai bucket con conteggio minore e maggiore
+     */
+    struct bucket
+    {
+        count_type _count;
+        entry *_first;
+        bucket *_lower;
+        bucket *_higher;
+
+        bucket(count_type count, bucket *lower, bucket *higher)
+            : _count(count), _first(nullptr), _lower(lower), _higher(higher) {}
+    };
+
+    entry *_head;
+    bucket *_top;
+    bucket *_bottom;
+    std::size_t _distinct;
+    count_type _size;
+    Comp _cmp;
+    Eq _eq;
+
+    // Crea un bucket con il conteggio indicato tra lower e higher
+    bucket *create_bucket(count_type count, bucket *lower, bucket *higher)
+    {
+        bucket *b = new bucket(count, lower, higher);
+        if (lower == nullptr)
+        {
+            _bottom = b;
+        }
+        else
+        {
+            lower->_higher = b;
+        }
+        if (higher == nullptr)
+        {
+            _top = b;
+        }
+        else
+        {
+            higher->_lower = b;
+        }
+        return b;
+    }
+
+    void link(entry *e, bucket *b)
+    {
+        e->_bucket = b;
+        e->_prev_rank = nullptr;
+        e->_next_rank = b->_first;
+        if (b->_first != nullptr)
+        {
+            b->_first->_prev_rank = e;
+        }
+        b->_first = e;
+    }
+
+    // Toglie e dal suo bucket, eliminando il bucket se resta vuoto
+    void unlink(entry *e)
+    {
+        bucket *b = e->_bucket;
+        if (e->_prev_rank == nullptr)
+        {
+            b->_first = e->_next_rank;
+        }
+        else
+        {
+            e->_prev_rank->_next_rank = e->_next_rank;
+        }
+        if (e->_next_rank != nullptr)
+        {
+            e->_next_rank->_prev_rank = e->_prev_rank;
+        }
+        e->_bucket = nullptr;
+        if (b->_first == nullptr)
+        {
+            if (b->_lower == nullptr)
+            {
+                _bottom = b->_higher;
+            }
+            else
+            {
+                b->_lower->_higher = b->_higher;
+            }
+            if (b->_higher == nullptr)
+            {
+                _top = b->_lower;
+            }
+            else
+            {
+                b->_higher->_lower = b->_lower;
+            }
+            delete b;
+        }
+    }
+
+    // Sposta e nel bucket del suo nuovo conteggio, adiacente a quello corrente
+    void promote(entry *e)
+    {
+        bucket *from = e->_bucket;
+        bucket *higher = from == nullptr ? _bottom : from->_higher;
+        if (higher == nullptr || higher->_count != e->_occurrences)
+        {
+            higher = create_bucket(e->_occurrences, from, higher);
+        }
+        if (from != nullptr)
+        {
+            unlink(e);
+        }
+        link(e, higher);
+    }
+
+    void demote(entry *e)
+    {
+        bucket *from = e->_bucket;
+        bucket *lower = from->_lower;
+        if (e->_occurrences > 0 && (lower == nullptr || lower->_count != e->_occurrences))
+        {
+            lower = create_bucket(e->_occurrences, lower, from);
+        }
+        unlink(e);
+        if (e->_occurrences > 0)
+        {
+            link(e, lower);
+        }
+    }
+
+public:
+    /**
+     * @brief Costruttore di default
+     */
+    ranked_multiset() : _head(nullptr), _top(nullptr), _bottom(nullptr), _distinct(0), _size(0) {}
+
+    /**
+     * @brief Copy constructor
+     * Copia la lista dei valori e ricostruisce i bucket con lo stesso ordine interno in O(n)
+     * @param other Multiset da copiare
+     */
+    ranked_multiset(const ranked_multiset &other)
+        : _head(nullptr), _top(nullptr), _bottom(nullptr), _distinct(0), _size(0)
+    {
+        std::unordered_map<const entry *, entry *> copies;
+        copies.reserve(other._distinct);
+        try
+        {
+            entry *tail = nullptr;
+            for (const entry *o = other._head; o != nullptr; o = o->_next)
+            {
+                entry *e = new entry(o->_value, nullptr);
+                e->_occurrences = o->_occurrences;
+                if (tail == nullptr)
+                {
+                    _head = e;
+                }
+                else
+                {
+                    tail->_next = e;
+                }
+                tail = e;
+                copies[o] = e;
+                ++_distinct;
+            }
+            for (const bucket *ob = other._bottom; ob != nullptr; ob = ob->_higher)
+            {
+                bucket *b = create_bucket(ob->_count, _top, nullptr);
+                entry *last = nullptr;
+                for (const entry *o = ob->_first; o != nullptr; o = o->_next_rank)
+                {
+                    entry *e = copies[o];
+                    e->_bucket = b;
+                    e->_prev_rank = last;
+                    if (last == nullptr)
+                    {
+                        b->_first = e;
+                    }
+                    else
+                    {
+                        last->_next_rank = e;
+                    }
+                    last = e;
+                }
+            }
+        }
+        catch (...)
+        {
+            clear();
+            throw;
+        }
+        _size = other._size;
+    }
+
+    /**
+     * @brief Operatore di assegnamento
+     * @param other Multiset da copiare
+     */
+    ranked_multiset &operator=(const ranked_multiset &other)
+    {
+        if (this != &other)
+        {
+            ranked_multiset tmp(other);
+            std::swap(_head, tmp._head);
+            std::swap(_top, tmp._top);
+            std::swap(_bottom, tmp._bottom);
+            std::swap(_distinct, tmp._distinct);
+            std::swap(_size, tmp._size);
+        }
+        return *this;
+    }
+
+    /**
+     * @brief Distruttore
+     */
+    ~ranked_multiset()
+    {
+        clear();
+    }
+
+    /**
+     * @brief Size
+     * Ritorna il numero totale di elementi (occorrenze comprese)
+     */
+    count_type size() const { return _size; }
+
+    /**
+     * @brief Distinct
+     * Ritorna il numero di valori distinti
+     */
+    std::size_t distinct() const { return _distinct; }
+
+    /**
+     * @brief Is Empty
+     * Controlla se il multiset e' vuoto
+     */
+    bool isEmpty() const { return _head == nullptr; }
+
+    /**
+     * @brief Add
+     * Aggiunge un valore al multiset e lo sposta nel bucket successivo
+     * @param value
+     */
+    void add(const T &value)
+    {
+        entry *curr = _head;
+        entry *prev = nullptr;
+        while (curr != nullptr && !_eq(curr->_value, value))
+        {
+            if (_cmp(curr->_value, value))
+            {
+                curr = nullptr;
+                break;
+            }
+            prev = curr;
+            curr = curr->_next;
+        }
+
+        if (curr == nullptr)
+        {
+            count_type d = count_traits<CountT>::room(_size, 1);
+            if (d == 0)
+            {
+                return;
+            }
+            curr = new entry(value, prev == nullptr ? _head : prev->_next);
+            curr->_occurrences = 1;
+            try
+            {
+                promote(curr);
+            }
+            catch (...)
+            {
+                delete curr;
+                throw;
+            }
+            if (prev == nullptr)
+            {
+                _head = curr;
+            }
+            else
+            {
+                prev->_next = curr;
+            }
+            ++_distinct;
+            _size += d;
+            return;
+        }
+
+        count_type d = count_traits<CountT>::room(curr->_occurrences, 1);
+        d = count_traits<CountT>::room(_size, d);
+        if (d == 0)
+        {
+            return;
+        }
+        curr->_occurrences += d;
+        try
+        {
+            promote(curr);
+        }
+        catch (...)
+        {
+            curr->_occurrences -= d;
+            throw;
+        }
+        _size += d;
+    }
+
+    /**
+     * @brief Remove
+     * Rimuove una occorrenza di un valore e lo sposta nel bucket precedente
+     * @param value
+     * @throw element_not_found_exception se il valore non e' presente
+     */
+    void remove(const T &value)
+    {
+        entry *curr = _head;
+        entry *prev = nullptr;
+        while (curr != nullptr && !_eq(curr->_value, value))
+        {
+            if (_cmp(curr->_value, value))
+            {
+                curr = nullptr;
+                break;
+            }
+            prev = curr;
+            curr = curr->_next;
+        }
+        if (curr == nullptr)
+        {
+            throw element_not_found_exception("Error, element not found in multiset");
+        }
+
+        --curr->_occurrences;
+        try
+        {
+            demote(curr);
+        }
+        catch (...)
+        {
+            ++curr->_occurrences;
+            throw;
+        }
+        --_size;
+        if (curr->_occurrences == 0)
+        {
+            if (prev == nullptr)
+            {
+                _head = curr->_next;
+            }
+            else
+            {
+                prev->_next = curr->_next;
+            }
+            delete curr;
+            --_distinct;
+        }
+    }
+
+    /**
+     * @brief Get the Occurrences
+     * Ritorna il numero di occorrenze di un valore
+     * @param value
+     */
+    count_type getOccurrences(const T &value) const
+    {
+        for (const entry *curr = _head; curr != nullptr && !_cmp(curr->_value, value); curr = curr->_next)
+        {
+            if (_eq(curr->_value, value))
+            {
+                return curr->_occurrences;
+            }
+        }
+        return 0;
+    }
+
+    /**
+     * @brief Contains
+     * Controlla se un valore e' presente nel multiset
+     * @param value
+     */
+    bool contains(const T &value) const
+    {
+        return getOccurrences(value) > 0;
+    }
+
+    /**
+     * @brief Most Frequent
+     * Ritorna un valore con il massimo numero di occorrenze in O(1)
+     * @throw element_not_found_exception se il multiset e' vuoto
+     */
+    const T &most_frequent() const
+    {
+        if (_top == nullptr)
+        {
+            throw element_not_found_exception("Error, multiset is empty");
+        }
+        return _top->_first->_value;
+    }
+
+    /**
+     * @brief Top K
+     * Ritorna fino a k valori con le loro occorrenze, dal piu' frequente, in O(k).
+     * A parita' di occorrenze l'ordine non e' specificato.
+     * @param k Numero massimo di valori
+     */
+    std::vector<std::pair<T, count_type> > top_k(std::size_t k) const
+    {
+        std::vector<std::pair<T, count_type> > result;
+        result.reserve(k < _distinct ? k : _distinct);
+        for (const bucket *b = _top; b != nullptr && result.size() < k; b = b->_lower)
+        {
+            for (const entry *e = b->_first; e != nullptr && result.size() < k; e = e->_next_rank)
+            {
+                result.push_back(std::make_pair(e->_value, e->_occurrences));
+            }
+        }
+        return result;
+    }
+
+    /**
+     * @brief Clear
+     * Svuota il multiset
+     */
+    void clear()
+    {
+        while (_head != nullptr)
+        {
+            entry *tmp = _head;
+            _head = _head->_next;
+            delete tmp;
+        }
+        while (_bottom != nullptr)
+        {
+            bucket *tmp = _bottom;
+            _bottom = _bottom->_higher;
+            delete tmp;
+        }
+        _top = nullptr;
+        _distinct = 0;
+        _size = 0;
+    }
+
+    /**
+     * @brief Const Iterator
+     * Iteratore costante sugli elementi nell'ordine di Comp, con la stessa semantica di multiset::const_iterator
+     */
+    class const_iterator
+    {
+    public:
+        typedef std::forward_iterator_tag iterator_category;
+        typedef T value_type;
+        typedef ptrdiff_t difference_type;
+        typedef const T *pointer;
+        typedef const T &reference;
+
+        const_iterator() : _ptr(nullptr), _counter(1) {}
+
+        const_iterator &operator++()
+        {
+            if (_counter == _ptr->_occurrences)
+            {
+                _ptr = _ptr->_next;
+                _counter = 1;
+            }
+            else
+            {
+                _counter++;
+            }
+            return *this;
+        }
+
+        const_iterator operator++(int)
+        {
+            const_iterator tmp(*this);
+            ++*this;
+            return tmp;
+        }
+
+        bool operator==(const const_iterator &other) const
+        {
+            return _ptr == other._ptr;
+        }
+
+        bool operator!=(const const_iterator &other) const
+        {
+            return !(*this == other);
+        }
+
+        reference operator*() const
+        {
+            return _ptr->_value;
+        }
+
+        pointer operator->() const
+        {
+            return &(_ptr->_value);
+        }
+
+        // Ritorna il numero di occorrenze dell'elemento puntato
+        count_type occurrences() const
+        {
+            return _ptr->_occurrences;
+        }
+
+    private:
+        friend class ranked_multiset;
+        const_iterator(const entry *p) : _ptr(p), _counter(1) {}
+        const entry *_ptr;
+        count_type _counter;
+    };
+
+    const_iterator begin() const
+    {
+        return const_iterator(_head);
+    }
+
+    const_iterator end() const
+    {
+        return const_iterator(nullptr);
+    }
+
+    /**
+     * @brief Operatore <<
+     * Stampa il multiset nello stesso formato di multiset
+     */
+    friend std::ostream &operator<<(std::ostream &os, const ranked_multiset &m)
+    {
+        os << "{";
+        for (const entry *curr = m._head; curr != nullptr; curr = curr->_next)
+        {
+            if (curr != m._head)
+            {
+                os << ", ";
+            }
+            os << "<" << curr->_value << ", " << curr->_occurrences << ">";
+        }
+        os << "}" << '\n';
+        return os;
+    }
+};
+
+#endif
@@ -0,0 +1,473 @@
+#ifndef SKIPLIST_MULTISET_H
+#define SKIPLIST_MULTISET_H
+
+#include <ostream>
+#include <iterator>
+#include <cstddef>
+#include <cstdint>
+#include <utility>
+#include "element_not_found_exception.h"
+#include "count_traits.h"
+
+/**
+ * @brief Multiset memorizzato in una skip list
+ *
+ * Il livello 0 e' la stessa lista ordinata secondo Comp di multiset (un nodo per valore con
+ * il numero di occorrenze, collegati da _next), quindi iterazione e stampa non cambiano.
+ * Circa un nodo su quattro sale anche al livello successivo, e cosi' via: le corsie veloci
+ * permettono di cercare, aggiungere e rimuovere un valore in O(log n) atteso.
+ * Ogni inserimento o rimozione modifica solo i puntatori dei nodi vicini, senza ribilanciamenti.
+ *
+ * @tparam T tipo del dato
+ * @tparam Comp funtore di comparazione
+ * @tparam Eq funtore di equivalenza
+ * @tparam CountT tipo delle occorrenze (vedi multiset)
+ */
+template <typename T, typename Comp, typename Eq, typename CountT = unsigned int>
+class skiplist_multiset
+{
+public:
+    typedef typename count_traits<CountT>::type count_type;
+
+    // Numero massimo di livelli: sufficiente per circa 4^16 valori distinti
+    static const std::size_t max_level = 16;
+
+private:
+    /**
+     * @brief Nodo della skip list
+     * _next e' il collegamento di livello 0, _express quelli dei livelli da 1 a _height - 1
+     */
+    struct node
+    {
+        T _value;
+        count_type _occurrences;
+        node *_next;
+        node **_express;
+        std::size_t _height;
+
+        node(const T &value, std::size_t height)
+            : _value(value), _occurrences(1), _next(nullptr),
+              _express(height > 1 ? new node *[height - 1]() : nullptr), _height(height) {}
+
+        ~node()
+        {
+            delete[] _express;
+        }
+
+        node *&next(std::size_t level)
+        {
+            return level == 0 ? _next : _express[level - 1];
+        }
+
+    private:
+        node(const node &);
+        node &operator=(const node &);
+    };
+
+    node *_heads[max_level];
+    std::size_t _level;
+    std::size_t _distinct;
+    count_type _size;
+    std::uint32_t _seed;
+    Comp _cmp;
+    Eq _eq;
+
+    // Collegamento di livello level che parte da prev (dalla testa se prev e' nullptr)
+    node *&link(node *prev, std::size_t level) const
+    {
+        return prev == nullptr ? const_cast<node *&>(_heads[level]) : prev->next(level);
+    }
+
+    // Altezza di un nuovo nodo: ogni livello in piu' con probabilita' 1/4 (xorshift32)
+    std::size_t random_height()
+    {
+        _seed ^= _seed << 13;
+        _seed ^= _seed >> 17;
+        _seed ^= _seed << 5;
+        std::uint32_t r = _seed;
+        std::size_t height = 1;
+        while (height < max_level && (r & 3) == 0)
+        {
+            ++height;
+            r >>= 2;
+        }
+        return height;
+    }
+
+    /**
+     * @brief Cerca il nodo di value
+     * @param update Se non e' nullptr riceve per ogni livello l'ultimo nodo che precede value
+     * @return node* Il nodo di value, nullptr se non e' presente
+     */
+    node *find(const T &value, node **update) const
+    {
+        node *prev = nullptr;
+        for (std::size_t level = _level; level-- > 0;)
+        {
+            node *n = link(prev, level);
+            // n precede value finche' value andrebbe inserito dopo di lui
+            while (n != nullptr && _cmp(value, n->_value))
+            {
+                prev = n;
+                n = n->next(level);
+            }
+            if (update != nullptr)
+            {
+                update[level] = prev;
+            }
+        }
+        node *n = link(prev, 0);
+        return n != nullptr && _eq(n->_value, value) ? n : nullptr;
+    }
+
+    // Accoda un nodo con l'altezza indicata, tails contiene l'ultimo nodo di ogni livello
+    void append(node *n, node **tails)
+    {
+        if (n->_height > _level)
+        {
+            _level = n->_height;
+        }
+        for (std::size_t level = 0; level < n->_height; ++level)
+        {
+            link(tails[level], level) = n;
+            tails[level] = n;
+        }
+        ++_distinct;
+    }
+
+public:
+    /**
+     * @brief Costruttore di default
+     */
+    skiplist_multiset() : _level(0), _distinct(0), _size(0), _seed(2463534242u)
+    {
+        for (std::size_t level = 0; level < max_level; ++level)
+        {
+            _heads[level] = nullptr;
+        }
+    }
+
+    /**
+     * @brief Copy constructor
+     * Copia i nodi con le stesse altezze in O(n), senza ricerche
+     * @param other Multiset da copiare
+     */
+    skiplist_multiset(const skiplist_multiset &other) : _level(0), _distinct(0), _size(0), _seed(other._seed)
+    {
+        node *tails[max_level];
+        for (std::size_t level = 0; level < max_level; ++level)
+        {
+            _heads[level] = nullptr;
+            tails[level] = nullptr;
+        }
+        try
+        {
+            for (node *o = other._heads[0]; o != nullptr; o = o->_next)
+            {
+                node *n = new node(o->_value, o->_height);
+                n->_occurrences = o->_occurrences;
+                append(n, tails);
+            }
+        }
+        catch (...)
+        {
+            clear();
+            throw;
+        }
+        _size = other._size;
+    }
+
+    /**
+     * @brief Operatore di assegnamento
+     * @param other Multiset da copiare
+     */
+    skiplist_multiset &operator=(const skiplist_multiset &other)
+    {
+        if (this != &other)
+        {
+            skiplist_multiset tmp(other);
+            for (std::size_t level = 0; level < max_level; ++level)
+            {
+                std::swap(_heads[level], tmp._heads[level]);
+            }
+            std::swap(_level, tmp._level);
+            std::swap(_distinct, tmp._distinct);
+            std::swap(_size, tmp._size);
+            std::swap(_seed, tmp._seed);
+        }
+        return *this;
+    }
+
+    /**
+     * @brief Distruttore
+     */
+    ~skiplist_multiset()
+    {
+        clear();
+    }
+
+    /**
+     * @brief Size
+     * Ritorna il numero totale di elementi (occorrenze comprese)
+     */
+    count_type size() const { return _size; }
+
+    /**
+     * @brief Distinct
+     * Ritorna il numero di valori distinti
+     */
+    std::size_t distinct() const { return _distinct; }
+
+    /**
+     * @brief Is Empty
+     * Controlla se il multiset e' vuoto
+     */
+    bool isEmpty() const { return _heads[0] == nullptr; }
+
+    /**
+     * @brief Add
+     * Aggiunge un valore al multiset in O(log n) atteso
+     * @param value
+     */
+    void add(const T &value)
+    {
+        node *update[max_level];
+        node *curr = find(value, update);
+        if (curr != nullptr)
+        {
+            count_type d = count_traits<CountT>::room(curr->_occurrences, 1);
+            d = count_traits<CountT>::room(_size, d);
+            curr->_occurrences += d;
+            _size += d;
+            return;
+        }
+
+        count_type d = count_traits<CountT>::room(_size, 1);
+        if (d == 0)
+        {
+            return;
+        }
+        node *n = new node(value, random_height());
+        for (std::size_t level = _level; level < n->_height; ++level)
+        {
+            update[level] = nullptr;
+        }
+        if (n->_height > _level)
+        {
+            _level = n->_height;
+        }
+        for (std::size_t level = 0; level < n->_height; ++level)
+        {
+            node *&from = link(update[level], level);
+            n->next(level) = from;
+            from = n;
+        }
+        ++_distinct;
+        _size += d;
+    }
+
+    /**
+     * @brief Remove
+     * Rimuove una occorrenza di un valore in O(log n) atteso
+     * @param value
+     * @throw element_not_found_exception se il valore non e' presente
+     */
+    void remove(const T &value)
+    {
+        node *update[max_level];
+        node *curr = find(value, update);
+        if (curr == nullptr)
+        {
+            throw element_not_found_exception("Error, element not found in multiset");
+        }
+        --_size;
+        if (--curr->_occurrences > 0)
+        {
+            return;
+        }
+        for (std::size_t level = 0; level < curr->_height; ++level)
+        {
+            link(update[level], level) = curr->next(level);
+        }
+        delete curr;
+        --_distinct;
+        while (_level > 0 && _heads[_level - 1] == nullptr)
+        {
+            --_level;
+        }
+    }
+
+    /**
+     * @brief Get the Occurrences
+     * Ritorna il numero di occorrenze di un valore
+     * @param value
+     */
+    count_type getOccurrences(const T &value) const
+    {
+        const node *n = find(value, nullptr);
+        return n == nullptr ? 0 : n->_occurrences;
+    }
+
+    /**
+     * @brief Contains
+     * Controlla se un valore e' presente nel multiset
+     * @param value
+     */
+    bool contains(const T &value) const
+    {
+        return find(value, nullptr) != nullptr;
+    }
+
+    /**
+     * @brief Clear
+     * Svuota il multiset
+     */
+    void clear()
+    {
+        while (_heads[0] != nullptr)
+        {
+            node *tmp = _heads[0];
+            _heads[0] = tmp->_next;
+            delete tmp;
+        }
+        for (std::size_t level = 0; level < max_level; ++level)
+        {
+            _heads[level] = nullptr;
+        }
+        _level = 0;
+        _distinct = 0;
+        _size = 0;
+    }
+
+    /**
+     * @brief Operatore di uguaglianza
+     * Le due liste sono ordinate allo stesso modo: basta confrontarle nodo per nodo in O(n)
+     * @param other Multiset da confrontare
+     */
+    bool operator==(const skiplist_multiset &other) const
+    {
+        if (_size != other._size || _distinct != other._distinct)
+        {
+            return false;
+        }
+        const node *a = _heads[0];
+        const node *b = other._heads[0];
+        for (; a != nullptr && b != nullptr; a = a->_next, b = b->_next)
+        {
+            if (!_eq(a->_value, b->_value) || a->_occurrences != b->_occurrences)
+            {
+                return false;
+            }
+        }
+        return a == nullptr && b == nullptr;
+    }
+
+    /**
+     * @brief Operatore di disuguaglianza
+     * @param other Multiset da confrontare
+     */
+    bool operator!=(const skiplist_multiset &other) const
+    {
+        return !(*this == other);
+    }
+
+    /**
+     * @brief Const Iterator
+     * Iteratore costante sugli elementi nell'ordine di Comp, con la stessa semantica di multiset::const_iterator
+     */
+    class const_iterator
+    {
+    public:
+        typedef std::forward_iterator_tag iterator_category;
+        typedef T value_type;
+        typedef ptrdiff_t difference_type;
+        typedef const T *pointer;
+        typedef const T &reference;
+
+        const_iterator() : _ptr(nullptr), _counter(1) {}
+
+        const_iterator &operator++()
+        {
+            if (_counter == _ptr->_occurrences)
+            {
+                _ptr = _ptr->_next;
+                _counter = 1;
+            }
+            else
+            {
+                _counter++;
+            }
+            return *this;
+        }
+
+        const_iterator operator++(int)
+        {
+            const_iterator tmp(*this);
+            ++*this;
+            return tmp;
+        }
+
+        bool operator==(const const_iterator &other) const
+        {
+            return _ptr == other._ptr;
+        }
+
+        bool operator!=(const const_iterator &other) const
+        {
+            return !(*this == other);
+        }
+
+        reference operator*() const
+        {
+            return _ptr->_value;
+        }
+
+        pointer operator->() const
+        {
+            return &(_ptr->_value);
+        }
+
+        // Ritorna il numero di occorrenze dell'elemento puntato
+        count_type occurrences() const
+        {
+            return _ptr->_occurrences;
+        }
+
+    private:
+        friend class skiplist_multiset;
+        const_iterator(const node *p) : _ptr(p), _counter(1) {}
+        const node *_ptr;
+        count_type _counter;
+    };
+
+    const_iterator begin() const
+    {
+        return const_iterator(_heads[0]);
+    }
+
+    const_iterator end() const
+    {
+        return const_iterator(nullptr);
+    }
+
+    /**
+     * @brief Operatore <<
+     * Stampa il multiset nello stesso formato di multiset
+     */
+    friend std::ostream &operator<<(std::ostream &os, const skiplist_multiset &m)
+    {
+        os << "{";
+        for (const node *curr = m._heads[0]; curr != nullptr; curr = curr->_next)
+        {
+            if (curr != m._heads[0])
+            {
+                os << ", ";
+            }
+            os << "<" << curr->_value << ", " << curr->_occurrences << ">";
+        }
+        os << "}" << '\n';
+        return os;
+    }
+};
+
+#endif
@@ -0,0 +1,597 @@
+#ifndef UNROLLED_MULTISET_H
+#define UNROLLED_MULTISET_H
+
+#include <ostream>
+#include <iterator>
+#include <cstddef>
+#include <new>
+#include <utility>
+#include "element_not_found_exception.h"
+#include "count_traits.h"
+
+/**
+ * @brief Multiset memorizzato in una lista di blocchi (unrolled linked list)
+ *
+ * Ogni blocco contiene fino a B coppie (valore, occorrenze) ordinate secondo Comp in due
+ * array contigui. La ricerca salta un blocco intero con un solo confronto sull'ultimo
+ * valore e cerca nel blocco giusto con una ricerca binaria; un nuovo valore sposta al
+ * massimo B elementi. Un blocco pieno si divide a meta'; un blocco che scende sotto B/4
+ * si unisce al successivo se insieme stanno in B/2, altrimenti gli prende il primo valore.
+ * Cosi' ogni blocco tranne l'ultimo e' pieno per almeno un quarto e le allocazioni sono
+ * circa una ogni B/2 valori distinti.
+ *
+ * @tparam T tipo del dato
+ * @tparam Comp funtore di comparazione
+ * @tparam Eq funtore di equivalenza
+ * @tparam CountT tipo delle occorrenze (vedi multiset)
+ * @tparam B numero massimo di valori per blocco (almeno 4)
+ */
+template <typename T, typename Comp, typename Eq, typename CountT = unsigned int, std::size_t B = 32>
+class unrolled_multiset
+{
+public:
+    typedef typename count_traits<CountT>::type count_type;
+
+private:
+    static_assert(B >= 4, "unrolled_multiset blocks must hold at least 4 values");
+
+    /**
+     * @brief Blocco della lista
+     * I primi _used valori di _bytes sono costruiti, _counts[i] sono le occorrenze del valore i
+     */
+    struct block
+    {
+        alignas(T) unsigned char _bytes[B * sizeof(T)];
+        count_type _counts[B];
+        std::size_t _used;
+        block *_next;
+
+        block() : _used(0), _next(nullptr) {}
+
+        ~block()
+        {
+            for (std::size_t i = 0; i < _used; ++i)
+            {
+                value(i).~T();
+            }
+        }
+
+        T &value(std::size_t i)
+        {
+            return reinterpret_cast<T *>(_bytes)[i];
+        }
+
+        const T &value(std::size_t i) const
+        {
+            return reinterpret_cast<const T *>(_bytes)[i];
+        }
+
+        // Sposta il valore i e il suo contatore nella posizione libera _used di to
+        void move_to(std::size_t i, block *to)
+        {
+            new (&to->value(to->_used)) T(std::move_if_noexcept(value(i)));
+            to->_counts[to->_used] = _counts[i];
+            ++to->_used;
+        }
+
+    private:
+        block(const block &);
+        block &operator=(const block &);
+    };
+
+    block *_head;
+    std::size_t _blocks;
+    std::size_t _distinct;
+    count_type _size;
+    Comp _cmp;
+    Eq _eq;
+
+    /**
+     * @brief Posizione di value
+     * Salta i blocchi il cui ultimo valore precede value, poi cerca con una ricerca binaria
+     * il primo valore del blocco che non precede value
+     * @param b Riceve il blocco (nullptr solo se la lista e' vuota)
+     * @param i Riceve l'indice del valore, o quello in cui andrebbe inserito
+     * @param prev Se non e' nullptr riceve il blocco che precede b (nullptr se b e' la testa)
+     * @return true se value e' presente in b alla posizione i
+     */
+    bool locate(const T &value, block *&b, std::size_t &i, block **prev = nullptr) const
+    {
+        b = _head;
+        i = 0;
+        if (prev != nullptr)
+        {
+            *prev = nullptr;
+        }
+        if (b == nullptr)
+        {
+            return false;
+        }
+        while (b->_next != nullptr && _cmp(value, b->value(b->_used - 1)))
+        {
+            if (prev != nullptr)
+            {
+                *prev = b;
+            }
+            b = b->_next;
+        }
+        std::size_t lo = 0;
+        std::size_t hi = b->_used;
+        while (lo < hi)
+        {
+            std::size_t mid = lo + (hi - lo) / 2;
+            if (_cmp(value, b->value(mid)))
+            {
+                lo = mid + 1;
+            }
+            else
+            {
+                hi = mid;
+            }
+        }
+        i = lo;
+        return i < b->_used && _eq(b->value(i), value);
+    }
+
+    // Divide un blocco pieno spostando la seconda meta' in un nuovo blocco successivo
+    block *split(block *b)
+    {
+        block *n = new block();
+        std::size_t half = b->_used / 2;
+        for (std::size_t i = half; i < b->_used; ++i)
+        {
+            b->move_to(i, n);
+        }
+        for (std::size_t i = half; i < b->_used; ++i)
+        {
+            b->value(i).~T();
+        }
+        b->_used = half;
+        n->_next = b->_next;
+        b->_next = n;
+        ++_blocks;
+        return n;
+    }
+
+    // Unisce a b il blocco successivo e lo libera
+    void merge_next(block *b)
+    {
+        block *n = b->_next;
+        for (std::size_t i = 0; i < n->_used; ++i)
+        {
+            n->move_to(i, b);
+        }
+        b->_next = n->_next;
+        delete n;
+        --_blocks;
+    }
+
+    // Sposta in fondo a b il primo valore del blocco successivo
+    void borrow_next(block *b)
+    {
+        block *n = b->_next;
+        n->move_to(0, b);
+        for (std::size_t j = 0; j + 1 < n->_used; ++j)
+        {
+            n->value(j) = std::move_if_noexcept(n->value(j + 1));
+            n->_counts[j] = n->_counts[j + 1];
+        }
+        --n->_used;
+        n->value(n->_used).~T();
+    }
+
+    // Libera un blocco vuoto, preceduto da prev
+    void unlink(block *prev, block *b)
+    {
+        if (prev == nullptr)
+        {
+            _head = b->_next;
+        }
+        else
+        {
+            prev->_next = b->_next;
+        }
+        delete b;
+        --_blocks;
+    }
+
+public:
+    /**
+     * @brief Costruttore di default
+     */
+    unrolled_multiset() : _head(nullptr), _blocks(0), _distinct(0), _size(0) {}
+
+    /**
+     * @brief Copy constructor
+     * Copia i blocchi cosi' come sono, in O(n)
+     * @param other Multiset da copiare
+     */
+    unrolled_multiset(const unrolled_multiset &other) : _head(nullptr), _blocks(0), _distinct(0), _size(0)
+    {
+        try
+        {
+            block *tail = nullptr;
+            for (const block *o = other._head; o != nullptr; o = o->_next)
+            {
+                block *b = new block();
+                if (tail == nullptr)
+                {
+                    _head = b;
+                }
+                else
+                {
+                    tail->_next = b;
+                }
+                tail = b;
+                ++_blocks;
+                for (std::size_t i = 0; i < o->_used; ++i)
+                {
+                    new (&b->value(i)) T(o->value(i));
+                    b->_counts[i] = o->_counts[i];
+                    ++b->_used;
+                }
+            }
+        }
+        catch (...)
+        {
+            clear();
+            throw;
+        }
+        _distinct = other._distinct;
+        _size = other._size;
+    }
+
+    /**
+     * @brief Operatore di assegnamento
+     * @param other Multiset da copiare
+     */
+    unrolled_multiset &operator=(const unrolled_multiset &other)
+    {
+        if (this != &other)
+        {
+            unrolled_multiset tmp(other);
+            std::swap(_head, tmp._head);
+            std::swap(_blocks, tmp._blocks);
+            std::swap(_distinct, tmp._distinct);
+            std::swap(_size, tmp._size);
+        }
+        return *this;
+    }
+
+    /**
+     * @brief Distruttore
+     */
+    ~unrolled_multiset()
+    {
+        clear();
+    }
+
+    /**
+     * @brief Size
+     * Ritorna il numero totale di elementi (occorrenze comprese)
+     */
+    count_type size() const { return _size; }
+
+    /**
+     * @brief Distinct
+     * Ritorna il numero di valori distinti
+     */
+    std::size_t distinct() const { return _distinct; }
+
+    /**
+     * @brief Blocks
+     * Ritorna il numero di blocchi allocati
+     */
+    std::size_t blocks() const { return _blocks; }
+
+    /**
+     * @brief Is Empty
+     * Controlla se il multiset e' vuoto
+     */
+    bool isEmpty() const { return _head == nullptr; }
+
+    /**
+     * @brief Add
+     * Aggiunge un valore al multiset; un valore nuovo sposta i valori successivi del suo blocco
+     * @param value
+     */
+    void add(const T &value)
+    {
+        block *b;
+        std::size_t i;
+        if (locate(value, b, i))
+        {
+            count_type d = count_traits<CountT>::room(b->_counts[i], 1);
+            d = count_traits<CountT>::room(_size, d);
+            b->_counts[i] += d;
+            _size += d;
+            return;
+        }
+
+        count_type d = count_traits<CountT>::room(_size, 1);
+        if (d == 0)
+        {
+            return;
+        }
+        T tmp(value);
+        if (b == nullptr)
+        {
+            b = _head = new block();
+            ++_blocks;
+        }
+        else if (b->_used == B)
+        {
+            block *n = split(b);
+            if (i > b->_used)
+            {
+                i -= b->_used;
+                b = n;
+            }
+        }
+        // apre lo spazio in posizione i spostando gli elementi successivi di un posto
+        if (i == b->_used)
+        {
+            new (&b->value(i)) T(std::move(tmp));
+        }
+        else
+        {
+            new (&b->value(b->_used)) T(std::move_if_noexcept(b->value(b->_used - 1)));
+            b->_counts[b->_used] = b->_counts[b->_used - 1];
+            for (std::size_t j = b->_used - 1; j > i; --j)
+            {
+                b->value(j) = std::move_if_noexcept(b->value(j - 1));
+                b->_counts[j] = b->_counts[j - 1];
+            }
+            b->value(i) = std::move(tmp);
+        }
+        b->_counts[i] = 1;
+        ++b->_used;
+        ++_distinct;
+        _size += d;
+    }
+
+    /**
+     * @brief Remove
+     * Rimuove una occorrenza di un valore; se era l'ultima il valore esce dal blocco e un
+     * blocco che scende sotto B/4 si unisce al successivo o gli prende un valore
+     * @param value
+     * @throw element_not_found_exception se il valore non e' presente
+     */
+    void remove(const T &value)
+    {
+        block *b;
+        block *prev;
+        std::size_t i;
+        if (!locate(value, b, i, &prev))
+        {
+            throw element_not_found_exception("Error, element not found in multiset");
+        }
+        --_size;
+        if (--b->_counts[i] > 0)
+        {
+            return;
+        }
+
+        for (std::size_t j = i; j + 1 < b->_used; ++j)
+        {
+            b->value(j) = std::move_if_noexcept(b->value(j + 1));
+            b->_counts[j] = b->_counts[j + 1];
+        }
+        --b->_used;
+        b->value(b->_used).~T();
+        --_distinct;
+
+        if (b->_next == nullptr)
+        {
+            // l'ultimo blocco puo' restare quasi vuoto, ma non vuoto
+            if (b->_used == 0)
+            {
+                unlink(prev, b);
+            }
+        }
+        else if (b->_used < B / 4)
+        {
+            if (b->_used + b->_next->_used <= B / 2)
+            {
+                merge_next(b);
+            }
+            else
+            {
+                borrow_next(b);
+            }
+        }
+    }
+
+    /**
+     * @brief Get the Occurrences
+     * Ritorna il numero di occorrenze di un valore
+     * @param value
+     */
+    count_type getOccurrences(const T &value) const
+    {
+        block *b;
+        std::size_t i;
+        return locate(value, b, i) ? b->_counts[i] : 0;
+    }
+
+    /**
+     * @brief Contains
+     * Controlla se un valore e' presente nel multiset
+     * @param value
+     */
+    bool contains(const T &value) const
+    {
+        block *b;
+        std::size_t i;
+        return locate(value, b, i);
+    }
+
+    /**
+     * @brief Clear
+     * Svuota il multiset
+     */
+    void clear()
+    {
+        while (_head != nullptr)
+        {
+            block *tmp = _head;
+            _head = _head->_next;
+            delete tmp;
+        }
+        _blocks = 0;
+        _distinct = 0;
+        _size = 0;
+    }
+
+    /**
+     * @brief Const Iterator
+     * Iteratore costante sugli elementi nell'ordine di Comp, con la stessa semantica di multiset::const_iterator
+     */
+    class const_iterator
+    {
+    public:
+        typedef std::forward_iterator_tag iterator_category;
+        typedef T value_type;
+        typedef ptrdiff_t difference_type;
+        typedef const T *pointer;
+        typedef const T &reference;
+
+        const_iterator() : _block(nullptr), _index(0), _counter(1) {}
+
+        const_iterator &operator++()
+        {
+            if (_counter == _block->_counts[_index])
+            {
+                _counter = 1;
+                if (++_index == _block->_used)
+                {
+                    _block = _block->_next;
+                    _index = 0;
+                }
+            }
+            else
+            {
+                _counter++;
+            }
+            return *this;
+        }
+
+        const_iterator operator++(int)
+        {
+            const_iterator tmp(*this);
+            ++*this;
+            return tmp;
+        }
+
+        bool operator==(const const_iterator &other) const
+        {
+            return _block == other._block && _index == other._index;
+        }
+
+        bool operator!=(const const_iterator &other) const
+        {
+            return !(*this == other);
+        }
+
+        reference operator*() const
+        {
+            return _block->value(_index);
+        }
+
+        pointer operator->() const
+        {
+            return &(_block->value(_index));
+        }
+
+        // Ritorna il numero di occorrenze dell'elemento puntato
+        count_type occurrences() const
+        {
+            return _block->_counts[_index];
+        }
+
+    private:
+        friend class unrolled_multiset;
+        const_iterator(const block *b) : _block(b), _index(0), _counter(1) {}
+        const block *_block;
+        std::size_t _index;
+        count_type _counter;
+    };
+
+    const_iterator begin() const
+    {
+        return const_iterator(_head);
+    }
+
+    const_iterator end() const
+    {
+        return const_iterator(nullptr);
+    }
+
+    /**
+     * @brief Operatore di uguaglianza
+     * I blocchi possono essere divisi diversamente: confronta i valori nell'ordine di Comp in O(n)
+     * @param other Multiset da confrontare
+     */
+    bool operator==(const unrolled_multiset &other) const
+    {
+        if (_size != other._size || _distinct != other._distinct)
+        {
+            return false;
+        }
+        const block *a = _head;
+        const block *b = other._head;
+        std::size_t i = 0;
+        std::size_t j = 0;
+        while (a != nullptr && b != nullptr)
+        {
+            if (!_eq(a->value(i), b->value(j)) || a->_counts[i] != b->_counts[j])
+            {
+                return false;
+            }
+            if (++i == a->_used)
+            {
+                a = a->_next;
+                i = 0;
+            }
+            if (++j == b->_used)
+            {
+                b = b->_next;
+                j = 0;
+            }
+        }
+        return a == nullptr && b == nullptr;
+    }
+
+    /**
+     * @brief Operatore di disuguaglianza
+     * @param other Multiset da confrontare
+     */
+    bool operator!=(const unrolled_multiset &other) const
+    {
+        return !(*this == other);
+    }
+
+    /**
+     * @brief Operatore <<
+     * Stampa il multiset nello stesso formato di multiset
+     */
+    friend std::ostream &operator<<(std::ostream &os, const unrolled_multiset &m)
+    {
+        os << "{";
+        for (const block *b = m._head; b != nullptr; b = b->_next)
+        {
+            for (std::size_t i = 0; i < b->_used; ++i)
+            {
+                if (b != m._head || i > 0)
+                {
+                    os << ", ";
+                }
+                os << "<" << b->value(i) << ", " << b->_counts[i] << ">";
+            }
+        }
+        os << "}" << '\n';
+        return os;
+    }
+};
+
+#endif
@@ -0,0 +1,184 @@
+#ifndef WINDOWED_MULTISET_H
+#define WINDOWED_MULTISET_H
+
+#include <cstddef>
+#include <cstdint>
+#include <stdexcept>
+#include <vector>
+#include "multiset.h"
+
+/**
+ * @brief Multiset a finestra scorrevole
+ *
+ * Ogni inserimento e' associato a un istante (un timestamp o un numero di sequenza).
+ * La finestra e' divisa in un anello di bucket di uguale ampiezza, ognuno con il multiset
+ * degli inserimenti del suo intervallo. Gli inserimenti vanno solo nel bucket corrente;
+ * quando il tempo passa al bucket successivo il bucket chiuso viene fuso nel multiset
+ * complessivo e i bucket usciti dalla finestra ne vengono sottratti, entrambe le cose
+ * in un solo passaggio (multiset::merge e multiset::subtract). Ogni evento viene quindi
+ * toccato un numero costante di volte, e non serve chiamare remove per ogni evento scaduto.
+ * La scadenza avviene a blocchi: la finestra effettiva va da window - window / buckets
+ * a window unita' di tempo.
+ *
+ * @tparam T tipo del dato
+ * @tparam Comp funtore di comparazione
+ * @tparam Eq funtore di equivalenza
+ * @tparam CountT tipo delle occorrenze (vedi multiset)
+ */
+template <typename T, typename Comp, typename Eq, typename CountT = unsigned int>
+class windowed_multiset
+{
+public:
+    typedef multiset<T, Comp, Eq, CountT> multiset_type;
+    typedef typename multiset_type::count_type count_type;
+
+private:
+    std::uint64_t _bucket_width;
+    std::vector<multiset_type> _buckets;
+    multiset_type _closed;
+    std::uint64_t _current;
+    std::uint64_t _sequence;
+
+    multiset_type &bucket(std::uint64_t id)
+    {
+        return _buckets[id % _buckets.size()];
+    }
+
+public:
+    /**
+     * @brief Costruttore
+     * @param window Ampiezza della finestra, nella stessa unita' dei timestamp
+     * @param buckets Numero di bucket in cui e' divisa la finestra
+     */
+    windowed_multiset(std::uint64_t window, std::size_t buckets)
+        : _bucket_width(0), _buckets(buckets), _current(0), _sequence(0)
+    {
+        if (buckets == 0 || window < buckets)
+        {
+            throw std::invalid_argument("Error, window must be at least as long as the number of buckets");
+        }
+        _bucket_width = window / buckets;
+    }
+
+    /**
+     * @brief Advance
+     * Fa avanzare la finestra fino all'istante now, facendo scadere i bucket usciti.
+     * Istanti precedenti a quello corrente vengono ignorati.
+     * @param now Istante corrente
+     */
+    void advance(std::uint64_t now)
+    {
+        std::uint64_t id = now / _bucket_width;
+        if (id <= _current)
+        {
+            return;
+        }
+        std::uint64_t count = _buckets.size();
+        if (id - _current >= count)
+        {
+            // tutta la finestra e' scaduta
+            for (std::size_t i = 0; i < _buckets.size(); ++i)
+            {
+                _buckets[i].clear();
+            }
+            _closed.clear();
+            _current = id;
+            return;
+        }
+        while (_current < id)
+        {
+            _closed.merge(bucket(_current));
+            ++_current;
+            multiset_type &expired = bucket(_current);
+            if (!expired.isEmpty())
+            {
+                _closed.subtract(expired);
+                expired.clear();
+            }
+        }
+    }
+
+    /**
+     * @brief Add
+     * Aggiunge un valore all'istante indicato, facendo avanzare la finestra se necessario.
+     * Un valore piu' vecchio del bucket corrente ma ancora nella finestra va nel suo bucket;
+     * uno gia' fuori dalla finestra viene ignorato.
+     * @param value
+     * @param timestamp Istante dell'inserimento
+     * @return true se il valore e' nella finestra
+     */
+    bool add(const T &value, std::uint64_t timestamp)
+    {
+        advance(timestamp);
+        std::uint64_t id = timestamp / _bucket_width;
+        if (id + _buckets.size() <= _current)
+        {
+            return false;
+        }
+        bucket(id).add(value);
+        if (id < _current)
+        {
+            _closed.add(value);
+        }
+        return true;
+    }
+
+    /**
+     * @brief Add
+     * Aggiunge un valore usando come istante un numero di sequenza interno:
+     * la finestra contiene cosi' gli ultimi window inserimenti
+     * @param value
+     */
+    void add(const T &value)
+    {
+        add(value, _sequence++);
+    }
+
+    /**
+     * @brief Get the Occurrences
+     * Ritorna le occorrenze di un valore nella finestra
+     * @param value
+     */
+    count_type getOccurrences(const T &value) const
+    {
+        return _closed.getOccurrences(value) + _buckets[_current % _buckets.size()].getOccurrences(value);
+    }
+
+    /**
+     * @brief Contains
+     * Controlla se un valore e' presente nella finestra
+     * @param value
+     */
+    bool contains(const T &value) const
+    {
+        return _closed.contains(value) || _buckets[_current % _buckets.size()].contains(value);
+    }
+
+    /**
+     * @brief Size
+     * Ritorna il numero di elementi nella finestra in O(1)
+     */
+    count_type size() const
+    {
+        return _closed.size() + _buckets[_current % _buckets.size()].size();
+    }
+
+    /**
+     * @brief Is Empty
+     * Controlla se la finestra e' vuota
+     */
+    bool isEmpty() const { return size() == 0; }
+
+    /**
+     * @brief Snapshot
+     * Ritorna un multiset con il contenuto corrente della finestra
+     */
+    multiset_type snapshot() const
+    {
+        multiset_type result(_closed);
+        result.merge(_buckets[_current % _buckets.size()]);
+        return result;
+    }
+};
+
+#endif